@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../tui/ansi_codes.h"
+#include "../tui/tui_diff.h"
+#include "../tui/tui_io.h"
+#include "../tui/tui_matrix.h"
+
+/* Times how long it takes to find the changed cells of a frame, once with a
+ * `cell_eq` loop and once with each kernel of `cells_find_diff` the CPU
+ * supports. Run it with `make RELEASE=1 bench`, the address sanitizer makes
+ * the numbers meaningless.
+ */
+
+#define WIDTH 500
+#define HEIGHT 150
+#define CHANGED_CELLS 300
+#define FRAMES 2000
+
+/* Keeps the compiler from dropping the loops, whose result is unused. */
+static volatile size_t found;
+
+/* Count the cells which differ between `a` and `b`, one cell at a time. */
+static size_t count_with_cell_eq(Matrix* a, Matrix* b) {
+  size_t count = 0;
+  for (size_t y = 0; y < HEIGHT; ++y) {
+    for (size_t x = 0; x < WIDTH; ++x) {
+      count += !cell_eq(matrix_cell_at(a, x, y), matrix_cell_at(b, x, y));
+    }
+  }
+  return count;
+}
+
+/* Count the cells which differ between `a` and `b` like `matrix_print_update`
+ * finds them: skip equal bytes with `cells_find_diff`, then confirm the cell
+ * with `cell_eq`. */
+static size_t count_with_kernel(Matrix* a, Matrix* b) {
+  size_t count = 0;
+  for (size_t y = 0; y < HEIGHT; ++y) {
+    Cell* ra = matrix_cell_at(a, 0, y);
+    Cell* rb = matrix_cell_at(b, 0, y);
+    for (size_t x = cells_find_diff(ra, rb, 0, WIDTH); x < WIDTH;
+         x = cells_find_diff(ra, rb, x + 1, WIDTH)) {
+      count += !cell_eq(ra + x, rb + x);
+    }
+  }
+  return count;
+}
+
+/* Returns the time per frame of `count` in microseconds. */
+static double time_frames(size_t (*count)(Matrix*, Matrix*), Matrix* a,
+                          Matrix* b) {
+  uint64_t start = clock_now();
+  for (int i = 0; i < FRAMES; ++i) {
+    found = count(a, b);
+  }
+  return (clock_now() - start) / 1e3 / FRAMES;
+}
+
+int main(void) {
+  Cell blank = {.content = ' ', .text_color = FG_WHITE,
+                .background_color = BG_BLACK};
+  Matrix* a = matrix_new(WIDTH, HEIGHT, &blank);
+  Matrix* b = matrix_new(WIDTH, HEIGHT, &blank);
+  srand(1);
+  for (int i = 0; i < CHANGED_CELLS; ++i) {
+    matrix_cell_at(b, rand() % WIDTH, rand() % HEIGHT)->content = '#';
+  }
+
+  printf("%dx%d cells, %d changed, us per frame:\n", WIDTH, HEIGHT,
+         CHANGED_CELLS);
+  printf("  cell_eq loop  %6.1f\n", time_frames(count_with_cell_eq, a, b));
+  const char* names[] = {"scalar", "SSE2", "AVX2"};
+  DiffKernel kernels[] = {DIFF_KERNEL_SCALAR, DIFF_KERNEL_SSE2,
+                          DIFF_KERNEL_AVX2};
+  for (int k = 0; k < 3; ++k) {
+    if (cells_diff_use_kernel(kernels[k])) {
+      printf("  %-6s kernel %6.1f\n", names[k],
+             time_frames(count_with_kernel, a, b));
+    } else {
+      printf("  %-6s kernel not supported by this CPU\n", names[k]);
+    }
+  }
+
+  matrix_free(a);
+  matrix_free(b);
+  return 0;
+}
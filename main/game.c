@@ -1,7 +1,7 @@
 #define MINIAUDIO_IMPLEMENTATION
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
-#include <unistd.h>
 
 #include "../tui/tui.h"
 #include "./game_lib.h"
@@ -21,7 +21,161 @@ void data_callback(ma_device *pDevice, void *pOutput, const void *pInput,
   (void)pInput;
 }
 
-int main(void) {
+/* How many time steps are simulated per second. */
+#define SIM_RATE 100
+
+/* How long a time step takes in nanoseconds. */
+#define STEP_NS (1000000000ULL / SIM_RATE)
+
+/* How many time steps the game may fall behind before the missed time is
+ * given up, see the main loop. */
+#define MAX_CATCH_UP 10
+
+/* How many frames are rendered per second, unless `--fps` says otherwise. */
+#define DEFAULT_FPS 60
+
+/* The size of the simulated terminal in headless mode. */
+#define HEADLESS_SIZE ((Size2){80, 24})
+
+/* Run `steps` time steps of the game with `seed` as fast as possible, without
+ * terminal and audio device, and print how many time steps per second were
+ * simulated. The numbers go to stderr, so they do not end up in a video which
+ * is recorded to stdout.
+ *
+ * Each time step handles the next key of `keys`, where '.' is no key, or a
+ * random key now and then if `keys` is NULL. The random keys also follow from
+ * `seed`, so a run can be repeated exactly. The ship is repaired whenever it
+ * is destroyed, so every run lasts `steps` time steps, unless a key quits.
+ *
+ * If `record_path` is not NULL, `fps` frames per second of game time are
+ * recorded as video, see `TUI_SINK_VIDEO`.
+ */
+static int run_headless(long steps, uint64_t seed, const char *keys,
+                        const char *record_path, int fps) {
+  bool record = record_path != NULL;
+  if (record) {
+    tui_init((TuiConfig){.sink = TUI_SINK_VIDEO,
+                         .size = HEADLESS_SIZE,
+                         .video_path = record_path,
+                         .video_fps = fps});
+  }
+  GameState game_state;
+  game_init(&game_state, HEADLESS_SIZE, seed);
+  /* A generator of its own, so the keys do not change what spawns. */
+  Rng input_rng;
+  rng_seed(&input_rng, ~seed);
+  if (record) {
+    draw_frame(&game_state);
+  }
+  size_t key_count = keys != NULL ? strlen(keys) : 0;
+  FramePacer pacer;
+  frame_pacer_init(&pacer, fps, SIM_RATE);
+  long destroyed = 0;
+
+  uint64_t start = clock_now();
+  long step = 0;
+  for (; step < steps; step++) {
+    char key = '.';
+    if (keys != NULL) {
+      key = keys[step % key_count];
+    } else if (rng_chance(&input_rng, 10)) {
+      key = "wasd "[rng_below(&input_rng, 5)];
+    }
+    if (key != '.' && handle_input(&game_state, key)) {
+      break;
+    }
+
+    if (game_update(&game_state)) {
+      destroyed++;
+      game_state.ship.health = 3;
+    }
+
+    if (frame_pacer_step(&pacer, false) && record) {
+      draw_game(&game_state);
+      tui_present();
+    }
+
+    game_next_step(&game_state);
+  }
+  double seconds = (clock_now() - start) / 1e9;
+
+  fprintf(stderr,
+          "%ld time steps with seed %llu in %.3f s: %.0f time steps/s\n", step,
+          (unsigned long long)seed, seconds, step / seconds);
+  fprintf(stderr, "ship destroyed %ld times, %d points\n", destroyed,
+          game_state.points);
+  fprintf(stderr,
+          "objects: %zu asteroids, %zu projectiles, %zu powerups, "
+          "%zu explosions, %zu mines\n",
+          vec_length(game_state.asteroids), vec_length(game_state.projectiles),
+          vec_length(game_state.powerups), vec_length(game_state.explosions),
+          vec_length(game_state.mines));
+
+  game_free(&game_state);
+  if (record) {
+    tui_shutdown();
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  /* Rendering is decoupled from the simulation: the game always runs at
+   * `SIM_RATE` time steps per second, but only every few time steps the latest
+   * state is drawn. A lower frame rate reduces what has to be printed to the
+   * terminal, e.g. over SSH, without changing the speed of the game. */
+  int fps = DEFAULT_FPS;
+  /* `--stats` prints how much was printed and how fast keys were shown. */
+  bool print_stats = false;
+  /* `--headless N` simulates N time steps without terminal, see
+   * `run_headless`. */
+  bool headless = false;
+  long headless_steps = 0;
+  /* `--seed N` replays the same game, otherwise every game is different. */
+  uint64_t seed = time(NULL);
+  const char *keys = NULL;
+  const char *record_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+      fps = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      print_stats = true;
+    } else if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+      headless = true;
+      headless_steps = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc) {
+      keys = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else {
+      printf("Usage: %s [--fps N] [--seed N] [--stats]\n"
+             "       %s --headless N [--seed N] [--keys KEYS] [--record FILE] "
+             "[--fps N]\n",
+             argv[0], argv[0]);
+      return 1;
+    }
+  }
+  if (fps < 1 || fps > SIM_RATE) {
+    printf("ERROR: --fps has to be between 1 and %d.\n", SIM_RATE);
+    return 1;
+  }
+  if (keys != NULL && keys[0] == 0) {
+    printf("ERROR: --keys must not be empty.\n");
+    return 1;
+  }
+  if (headless && headless_steps < 1) {
+    printf("ERROR: --headless needs at least 1 time step.\n");
+    return 1;
+  }
+  if (headless) {
+    return run_headless(headless_steps, seed, keys, record_path, fps);
+  }
+  if (keys != NULL || record_path != NULL) {
+    printf("ERROR: --keys and --record only work with --headless.\n");
+    return 1;
+  }
+
   ma_result result;
   ma_decoder decoder;
   ma_device_config deviceConfig;
@@ -50,16 +204,11 @@ int main(void) {
     return -4;
   }
 
-  tui_init();
-
-  /* Initialize the random number generator with the current time, such that
-   * `rand()` produces different random numbers every time we run the program.
-   */
-  srand(time(NULL));
+  tui_init((TuiConfig){.sink = TUI_SINK_TERMINAL});
 
   /* We require that the terminal window has space for at least 40 columns and
    * 20 rows. Otherwise, we exit the programm with an error message.
-   * We assume that the terminal size doesn't change after the game has started.
+   * If the terminal is made smaller than this later, the game pauses.
    */
   Size2 min_term_size = {40, 20};
   Size2 term_size = tui_size();
@@ -70,117 +219,169 @@ int main(void) {
     exit(1);
   }
 
-  /* The game field starts at position {1, 1}. This accounts for the white frame
+  /* Initialize the game state, which you have to manipulate in the functions
+   * from game_lib.c. The GameState-struct is defined and documented in
+   * game_lib.h.
+   *
+   * The game field starts at position {1, 1}. This accounts for the white frame
    * drawn around the game field.
    *
    * The game field ends a few rows above the bottom of the terminal, so we have
    * space to render the info text (see screenshots).
+   *
+   * The frame lives on the static layer, so it is only drawn again when the
+   * terminal is resized.
    */
-  Int2 field_begin = {1, 1};
-  Int2 field_end = {term_size.x - 1, term_size.y - 3};
-  Int2 field_size = {field_end.x - field_begin.x, field_end.y - field_begin.y};
-
-  /* Initialize the game state, which you have to manipulate in the functions
-   * from game_lib.c. The GameState-struct is defined and documented in
-   * game_lib.h. */
-  GameState game_state = {
-      .term_size = {term_size.x, term_size.y}, /* Convert Size2 to Int2. */
-      .field_begin = field_begin,
-      .field_end = field_end,
-      .field_size = field_size,
-      .ship =
-          {
-              .pos = {1, field_size.y /
-                             2}, /* At the beginning, the ship is positioned */
-              .health = 3,       /* left to the center of the game field. */
-              .powerup_time = 0,
-          },
-      .points = 0,
-      .projectiles = vec_new(),
-      .asteroids = vec_new(),
-      .powerups = vec_new(),
-      .explosions = vec_new(),
-      .time_step = 0,
-      .asteroid_speed = 1,
-      .mines = vec_new()};
+  GameState game_state;
+  game_init(&game_state, term_size, seed);
+  draw_frame(&game_state);
+
+  /* Decides which time steps are rendered, see `frame_pacer_step`. */
+  FramePacer pacer;
+  frame_pacer_init(&pacer, fps, SIM_RATE);
+
+  /* The time at which the next time step is due. It is advanced by exactly one
+   * period per time step, so the game keeps its speed no matter how long a
+   * time step takes. The time between `next_step` and now accumulates the
+   * time steps which are overdue. */
+  uint64_t next_step = clock_now();
+  uint64_t late_steps = 0;    /* Time steps which started a period late. */
+  uint64_t skipped_steps = 0; /* Time steps which were given up. */
+
+  /* When the oldest key which is not shown yet arrived, or 0. The time until
+   * the next frame is presented is the latency of the input. */
+  uint64_t unshown_key_time = 0;
+  uint64_t latency_sum = 0;
+  uint64_t latency_max = 0;
+  uint64_t latency_count = 0;
+
+  /* True while the game is paused, because the terminal is too small. */
+  bool needs_layout = false;
+
+  /* Keys are collected by the input thread while we sleep. */
+  input_start();
 
   while (1) {
-    /* Handle Keyboard Input */
+    /* Handle Keyboard Input
+     *
+     * Sleep until the next time step is due, then handle all keys which
+     * arrived before it. Keys which arrive while the time step is computed
+     * belong to the next one. */
+
+    sleep_until(next_step);
+
+    /* If the machine is too busy, time steps become overdue. They are run
+     * back to back without rendering until the game has caught up, so the
+     * game keeps running at exactly `SIM_RATE` and only the frame rate drops.
+     * If the game falls behind by more than `MAX_CATCH_UP` time steps, the
+     * missed time is given up and the game slows down, instead of trying to
+     * catch up with ever more time steps. Then skipping frames does not help
+     * anymore, so they are rendered again. Even while the game catches up,
+     * at most `MAX_SKIPPED_FRAMES` frames in a row are skipped. */
+
+    uint64_t now = clock_now();
+    bool behind = now >= next_step + STEP_NS;
+    if (behind) {
+      late_steps++;
+    }
+    if (now > next_step + MAX_CATCH_UP * STEP_NS) {
+      uint64_t skipped = (now - next_step) / STEP_NS - MAX_CATCH_UP;
+      skipped_steps += skipped;
+      next_step += skipped * STEP_NS;
+      behind = false;
+    }
 
-    if (stdin_has_changed()) {
-      char c = read_from_stdin();
-      if (handle_input(&game_state, c)) {
-        break;
+    bool quit = false;
+    KeyEvent key;
+    while (!quit && input_next(&key, next_step)) {
+      quit = handle_input(&game_state, key.key);
+      if (unshown_key_time == 0) {
+        unshown_key_time = key.time;
       }
     }
-
-    /* Update the GameState. */
-
-    move_projectiles(&game_state);
-    handle_projectile_asteroid_collisions(&game_state);
-
-    move_asteroids(&game_state);
-    spawn_asteroids(&game_state);
-    handle_projectile_asteroid_collisions(&game_state);
-    handle_asteroid_ship_collisions(&game_state);
-
-    move_powerups(&game_state);
-    spawn_powerups(&game_state);
-    handle_powerup_ship_collisions(&game_state);
-
-    move_explosions(&game_state);
-
-    move_mines(&game_state);
-    spawn_mines(&game_state);
-    handle_mines_ship_collisions(&game_state);
-
-    /* Exit the game, if the ship was hit by enough asteroids. */
-    if (game_state.ship.health <= 0) {
+    /* The terminal is gone if stdin can not be read anymore. */
+    if (quit || input_closed()) {
       break;
     }
 
-    /* If the ship currently has a powerup, decrease the time
-     * until the powerup is gone. */
-    if (game_state.ship.powerup_time > 0) {
-      game_state.ship.powerup_time--;
+    /* Lay out the game field again, if the terminal was resized. The
+     * SIGWINCH handler only sets a flag, which `tui_size` checks here once
+     * per time step, so a resize shows up at the latest one time step later.
+     */
+
+    term_size = tui_size();
+    if (needs_layout || term_size.x != game_state.term_size.x ||
+        term_size.y != game_state.term_size.y) {
+      if (term_size.x < min_term_size.x || term_size.y < min_term_size.y) {
+        /* Pause until the terminal is large enough again. The layers have
+         * already been shrunk, which cut off the frame and the info bar, so
+         * they have to be laid out again even if the terminal gets back its
+         * old size. */
+        needs_layout = true;
+        next_step += STEP_NS;
+        continue;
+      }
+      resize_field(&game_state, term_size);
+      draw_frame(&game_state);
+      needs_layout = false;
     }
 
-    /* Draw the GameState in the terminal. */
+    /* Update the GameState and exit the game, if the ship was hit by enough
+     * asteroids. */
 
-    tui_clear();
-
-    draw_info_bar(&game_state);
-    draw_frame(&game_state);
-    draw_ship(&game_state);
-    draw_projectiles(&game_state);
-    draw_asteroids(&game_state);
-    draw_powerups(&game_state);
-    draw_explosions(&game_state);
-    draw_mines(&game_state);
-
-    tui_update();
+    if (game_update(&game_state)) {
+      break;
+    }
 
-    /* Increase time step and wait for 10000 µs (0.01 s). */
+    /* Draw the GameState in the terminal, if this time step is due for a
+     * frame and the game is not catching up. */
 
-    game_state.time_step++;
+    if (frame_pacer_step(&pacer, behind)) {
+      draw_game(&game_state);
+      tui_present();
 
-    if (game_state.asteroid_speed > 1) {
-      game_state.asteroid_speed -= 0.001;
+      if (unshown_key_time != 0) {
+        uint64_t latency = clock_now() - unshown_key_time;
+        latency_sum += latency;
+        latency_max = latency > latency_max ? latency : latency_max;
+        latency_count++;
+        unshown_key_time = 0;
+      }
     }
 
-    usleep(10000);
+    /* Increase time step and schedule the next one 0.01 s after this one,
+     * i.e. one time step at `SIM_RATE`. */
+
+    game_next_step(&game_state);
+    next_step += STEP_NS;
   }
+  input_stop();
 
   /* Free our vectors and their data storage. */
-  vec_free(game_state.explosions);
-  vec_free(game_state.powerups);
-  vec_free(game_state.asteroids);
-  vec_free(game_state.projectiles);
-  vec_free(game_state.mines);
-  printf(COLOR_RESET);
-  fflush(stdout);
+  game_free(&game_state);
+  /* `tui_shutdown` resets the colors after the output thread has stopped. */
+  TuiStats stats = tui_stats();
   tui_shutdown();
 
+  /* Frames are dropped instead of slowing down the game, if the terminal is
+   * too slow, e.g. over SSH. Let the player know why the game looked choppy. */
+  if (stats.dropped_frames > 0) {
+    printf("%lu frames were dropped because the terminal was too slow.\n",
+           (unsigned long)stats.dropped_frames);
+  }
+  if (print_stats) {
+    printf("frames: %lu, dropped: %lu, bytes: %lu, cells: %lu\n",
+           (unsigned long)stats.frames, (unsigned long)stats.dropped_frames,
+           (unsigned long)stats.bytes, (unsigned long)stats.cells);
+    printf("time steps: %d, late: %lu, skipped: %lu, frames skipped: %lu\n",
+           game_state.time_step, (unsigned long)late_steps,
+           (unsigned long)skipped_steps, (unsigned long)pacer.skipped);
+    if (latency_count > 0) {
+      printf("input latency: %.1f ms average, %.1f ms max\n",
+             latency_sum / 1e6 / latency_count, latency_max / 1e6);
+    }
+  }
+
   ma_device_uninit(&device);
   ma_decoder_uninit(&decoder);
   return 0;
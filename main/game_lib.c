@@ -1,17 +1,190 @@
 #include <assert.h>
-#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "../tui/tui.h"
 
 #include "./game_lib.h"
 
+/* The speed of the asteroids in 1/FIX_ONE cells per time step: usually a
+ * quarter cell, after a mine one cell, from where it slows down again over
+ * ASTEROID_SLOW_DOWN_STEPS time steps. */
+#define ASTEROID_SPEED (FIX_ONE / 4)
+#define ASTEROID_MINE_SPEED FIX_ONE
+#define ASTEROID_SLOW_DOWN_STEPS 3000
+
+/* Asteroids are up to this much faster or slower than `asteroid_speed`. */
+#define ASTEROID_SPEED_SPREAD (FIX_ONE / 16)
+
+/* The fields of the info bar in the order in which they are shown. */
+enum { INFO_LIFES, INFO_POINTS, INFO_DISTANCE, INFO_POWERUP };
+
+/* `vec_retain` callback which keeps the objects at positions `pos` inside the
+ * field of `gs`. Also works for `Explosion`s, which start with their position.
+ */
+static bool is_inside_field(void *pos, void *gs) {
+  Int2 *p = pos;
+  return is_field_coordinate(gs, p->x, p->y);
+}
+
+/* Like `is_inside_field` for `Asteroid`s. */
+static bool asteroid_is_inside_field(void *a, void *gs) {
+  Int2 p = asteroid_pos(gs, a);
+  return is_field_coordinate(gs, p.x, p.y);
+}
+
+/* Like `is_inside_field` for powerups and mines. */
+static bool drift_is_inside_field(void *s, void *gs) {
+  Int2 p = drift_pos(gs, s);
+  return is_field_coordinate(gs, p.x, p.y);
+}
+
+void resize_field(GameState *gs, Size2 term_size) {
+  gs->term_size = (Int2){term_size.x, term_size.y};
+  gs->field_begin = (Int2){1, 1};
+  gs->field_end = (Int2){term_size.x - 1, term_size.y - 3};
+  gs->field_size = (Int2){gs->field_end.x - gs->field_begin.x,
+                          gs->field_end.y - gs->field_begin.y};
+  gs->info_bar_ready = false;
+
+  /* Same limits as in `handle_input`. */
+  if (gs->ship.pos.x > gs->field_size.x - 6) {
+    gs->ship.pos.x = gs->field_size.x - 6;
+  }
+  if (gs->ship.pos.y > gs->field_size.y - 3) {
+    gs->ship.pos.y = gs->field_size.y - 3;
+  }
+  vec_retain(gs->projectiles, is_inside_field, gs);
+  vec_retain(gs->asteroids, asteroid_is_inside_field, gs);
+  vec_retain(gs->powerups, drift_is_inside_field, gs);
+  vec_retain(gs->explosions, is_inside_field, gs);
+  vec_retain(gs->mines, drift_is_inside_field, gs);
+}
+
+void game_init(GameState *gs, Size2 term_size, uint64_t seed) {
+  *gs = (GameState){
+      .ship =
+          {
+              .health = 3,
+              .powerup_time = 0,
+          },
+      .points = 0,
+      .projectiles = vec_new(),
+      .asteroids = vec_new(),
+      .powerups = vec_new(),
+      .explosions = vec_new(),
+      .time_step = 0,
+      .asteroid_speed = ASTEROID_SPEED,
+      .mines = vec_new()};
+  rng_seed(&gs->rng, seed);
+  resize_field(gs, term_size);
+  gs->ship.pos = (Int2){1, gs->field_size.y / 2};
+}
+
+void game_free(GameState *gs) {
+  vec_free(gs->explosions);
+  vec_free(gs->powerups);
+  vec_free(gs->asteroids);
+  vec_free(gs->projectiles);
+  vec_free(gs->mines);
+}
+
+bool game_update(GameState *gs) {
+  move_projectiles(gs);
+  handle_projectile_asteroid_collisions(gs);
+
+  move_drifting_objects(gs);
+  spawn_asteroids(gs);
+  handle_projectile_asteroid_collisions(gs);
+  handle_asteroid_ship_collisions(gs);
+
+  spawn_powerups(gs);
+  handle_powerup_ship_collisions(gs);
+
+  move_explosions(gs);
+
+  spawn_mines(gs);
+  handle_mines_ship_collisions(gs);
+
+  if (gs->ship.health <= 0) {
+    return true;
+  }
+
+  /* If the ship currently has a powerup, decrease the time until the powerup
+   * is gone. */
+  if (gs->ship.powerup_time > 0) {
+    gs->ship.powerup_time--;
+  }
+  return false;
+}
+
+void game_next_step(GameState *gs) {
+  gs->time_step++;
+
+  if (gs->asteroid_speed > ASTEROID_SPEED) {
+    gs->asteroid_speed -= (ASTEROID_MINE_SPEED - ASTEROID_SPEED) /
+                          ASTEROID_SLOW_DOWN_STEPS;
+  }
+}
+
+void frame_pacer_init(FramePacer *p, int fps, int sim_rate) {
+  *p = (FramePacer){.fps = fps,
+                    .sim_rate = sim_rate,
+                    .credit = sim_rate,
+                    .skipped_in_row = 0,
+                    .skipped = 0};
+}
+
+bool frame_pacer_step(FramePacer *p, bool catching_up) {
+  bool due = p->credit >= p->sim_rate;
+  p->credit += p->fps;
+  if (!due) {
+    return false;
+  }
+  p->credit -= p->sim_rate;
+  if (catching_up && p->skipped_in_row < MAX_SKIPPED_FRAMES) {
+    p->skipped_in_row++;
+    p->skipped++;
+    return false;
+  }
+  p->skipped_in_row = 0;
+  return true;
+}
+
+void draw_game(GameState *gs) {
+  /* Clearing only resets the cells of the entities drawn in the previous
+   * frame. */
+  tui_clear();
+
+  draw_info_bar(gs);
+  draw_ship(gs);
+  draw_projectiles(gs);
+  draw_asteroids(gs);
+  draw_powerups(gs);
+  draw_explosions(gs);
+  draw_mines(gs);
+}
+
 void draw_info_bar(GameState *gs) {
-  char buf[255];
-  sprintf(buf, "LIFES: %d    POINTS: %d    DISTANCE: %d    POWERUP: %d",
-          gs->ship.health, gs->points, gs->time_step, gs->ship.powerup_time);
-  tui_set_str_at(0, gs->term_size.y - 1, buf, FG_WHITE, BG_BLACK);
+  /* The HUD layer keeps its content, so the fields are only redrawn when
+   * their values change. */
+  Hud *hud = &gs->info_bar;
+  if (!gs->info_bar_ready) {
+    tui_layer_clear(TUI_LAYER_HUD);
+    hud_init(hud, 0, gs->term_size.y - 1, gs->term_size.x, 4, FG_WHITE,
+             BG_BLACK);
+    hud_add_field(hud, "LIFES: ");
+    hud_add_field(hud, "POINTS: ");
+    hud_add_field(hud, "DISTANCE: ");
+    hud_add_field(hud, "POWERUP: ");
+    gs->info_bar_ready = true;
+  }
+  hud_set(hud, INFO_LIFES, gs->ship.health);
+  hud_set(hud, INFO_POINTS, gs->points);
+  hud_set(hud, INFO_DISTANCE, gs->time_step);
+  hud_set(hud, INFO_POWERUP, gs->ship.powerup_time);
+  hud_draw(hud);
 }
 
 void draw_frame(GameState *gs) {
@@ -19,20 +192,34 @@ void draw_frame(GameState *gs) {
       .content = ' ', .text_color = FG_WHITE, .background_color = BG_WHITE};
   Int2 frame_begin = {gs->field_begin.x - 1, gs->field_begin.y - 1};
   Int2 frame_end = {gs->field_end.x + 1, gs->field_end.y + 1};
+  tui_layer_clear(TUI_LAYER_STATIC);
   for (size_t x = frame_begin.x; x < frame_end.x; ++x) {
-    *tui_cell_at(x, frame_begin.y) = c;
-    *tui_cell_at(x, frame_end.y - 1) = c;
+    *tui_layer_cell_at(TUI_LAYER_STATIC, x, frame_begin.y) = c;
+    *tui_layer_cell_at(TUI_LAYER_STATIC, x, frame_end.y - 1) = c;
   }
   for (size_t y = frame_begin.y; y < frame_end.y; ++y) {
-    *tui_cell_at(frame_begin.x, y) = c;
-    *tui_cell_at(frame_end.x - 1, y) = c;
+    *tui_layer_cell_at(TUI_LAYER_STATIC, frame_begin.x, y) = c;
+    *tui_layer_cell_at(TUI_LAYER_STATIC, frame_end.x - 1, y) = c;
   }
 }
 
+Int2 asteroid_pos(const GameState *gs, const Asteroid *a) {
+  int64_t distance = gs->asteroid_distance - a->spawn_distance +
+                     (int64_t)a->speed *
+                         (gs->drift_steps - a->spawn.drift_steps);
+  int64_t x = ((int64_t)a->spawn.origin.x << FIX_SHIFT) - distance;
+  return (Int2){x >> FIX_SHIFT, a->spawn.origin.y};
+}
+
+Int2 drift_pos(const GameState *gs, const Spawn *s) {
+  return (Int2){s->origin.x - (gs->drift_steps - s->drift_steps),
+                s->origin.y};
+}
+
 bool is_field_coordinate(GameState *gs, int x, int y) {
   Int2 size = gs->field_size;
   bool x_is_valid = 0 <= x && x < size.x;
-  bool y_is_valid = 0 <= y && y < size.x;
+  bool y_is_valid = 0 <= y && y < size.y;
   return x_is_valid && y_is_valid;
 }
 
@@ -47,7 +234,10 @@ Cell *field_cell_at(GameState *gs, int x, int y) {
    * To get the stack trace, we use an ugly hack: if the assertion fails, we
    * simply cause a segmentation fault by writing to the NULL-Pointer, which the
    * address sanitizer then detects and spits out a stack trace for us :3
+   *
+   * Release builds skip the check, the callers clip their coordinates.
    */
+#ifdef TUI_CHECKS
   if (!is_field_coordinate(gs, x, y)) {
     tui_shutdown();
     printf(FG_RED "ASSERTION FAILED: Coordinate (%d, %d) is not a valid game "
@@ -57,38 +247,38 @@ Cell *field_cell_at(GameState *gs, int x, int y) {
     int *null = NULL;
     *null = 42;
   }
+#endif
 
   return tui_cell_at(x + gs->field_begin.x, y + gs->field_begin.y);
 }
 
+void draw_sprite(GameState *gs, const Sprite *s, int x, int y) {
+  Size2 clip_begin = {gs->field_begin.x, gs->field_begin.y};
+  Size2 clip_end = {gs->field_end.x, gs->field_end.y};
+  tui_layer_blit(TUI_LAYER_ENTITY, s, x + gs->field_begin.x,
+                 y + gs->field_begin.y, clip_begin, clip_end);
+}
+
+/* The cells of the ship, in the order of the keys "-=B>". */
+static const Cell ship_cells[] = {
+    {.content = '-', .text_color = FG_YELLOW, .background_color = BG_BLACK},
+    {.content = '=', .text_color = FG_YELLOW, .background_color = BG_BLACK},
+    {.content = ' ', .text_color = FG_GREEN, .background_color = BG_GREEN},
+    {.content = '>', .text_color = FG_YELLOW, .background_color = BG_BLACK},
+};
+
 void draw_ship(GameState *gs) {
-  Cell beam = (Cell){
-      .content = '-', .text_color = FG_YELLOW, .background_color = BG_BLACK};
-  Cell engine = (Cell){
-      .content = '=', .text_color = FG_YELLOW, .background_color = BG_BLACK};
-  Cell body = (Cell){
-      .content = ' ', .text_color = FG_GREEN, .background_color = BG_GREEN};
-  Cell top = (Cell){
-      .content = '>', .text_color = FG_YELLOW, .background_color = BG_BLACK};
-  Int2 ship_begin = {gs->ship.pos.x, gs->ship.pos.y - 1};
-  for (int i = ship_begin.y; i < ship_begin.y + 3; i++) {
-    *field_cell_at(gs, ship_begin.x, i) = beam;
-  }
-  for (int i = ship_begin.y; i < ship_begin.y + 3; i++) {
-    *field_cell_at(gs, ship_begin.x + 1, i) = engine;
-  }
-  for (int i = ship_begin.y; i < ship_begin.y + 3; i++) {
-    *field_cell_at(gs, ship_begin.x + 2, i) = body;
-    if (i == ship_begin.y + 1) {
-      *field_cell_at(gs, ship_begin.x + 2, i) = body;
-      *field_cell_at(gs, ship_begin.x + 3, i) = body;
-      *field_cell_at(gs, ship_begin.x + 4, i) = top;
-    }
-  }
-  if (gs->ship.powerup_time > 0) {
-    *field_cell_at(gs, ship_begin.x + 3, ship_begin.y) = top;
-    *field_cell_at(gs, ship_begin.x + 3, ship_begin.y + 2) = top;
-  }
+  /* The sprites are built on first use. The origin is the ship's position. */
+  static Sprite *ship = NULL;
+  static Sprite *powerup_ship = NULL;
+  if (ship == NULL) {
+    const char *rows[] = {"-=B", "-=BB>", "-=B"};
+    ship = sprite_new(rows, 3, 0, 1, "-=B>", ship_cells);
+    const char *powerup_rows[] = {"-=B>", "-=BB>", "-=B>"};
+    powerup_ship = sprite_new(powerup_rows, 3, 0, 1, "-=B>", ship_cells);
+  }
+  draw_sprite(gs, gs->ship.powerup_time > 0 ? powerup_ship : ship,
+              gs->ship.pos.x, gs->ship.pos.y);
 }
 
 void draw_projectiles(GameState *gs) {
@@ -97,30 +287,33 @@ void draw_projectiles(GameState *gs) {
   Int2 *ppos = NULL;
   for (size_t i = 0; i < vec_length(gs->projectiles); i++) {
     ppos = *vec_at(gs->projectiles, i);
-    *field_cell_at(gs, ppos->x, ppos->y) = p;
+    if (is_field_coordinate(gs, ppos->x, ppos->y)) {
+      *field_cell_at(gs, ppos->x, ppos->y) = p;
+    }
   }
 }
 
 void draw_asteroids(GameState *gs) {
-  Cell a = (Cell){
-      .content = ' ', .text_color = FG_WHITE, .background_color = BG_WHITE};
-  Int2 *ppos = NULL;
+  static Sprite *asteroid = NULL;
+  if (asteroid == NULL) {
+    const char *rows[] = {"#"};
+    Cell a = (Cell){
+        .content = ' ', .text_color = FG_WHITE, .background_color = BG_WHITE};
+    asteroid = sprite_new(rows, 1, 0, 0, "#", &a);
+  }
   for (size_t i = 0; i < vec_length(gs->asteroids); i++) {
-    ppos = *vec_at(gs->asteroids, i);
-    if (is_field_coordinate(gs, ppos->x, ppos->y)) {
-      *field_cell_at(gs, ppos->x, ppos->y) = a;
-    }
+    Int2 pos = asteroid_pos(gs, *vec_at(gs->asteroids, i));
+    draw_sprite(gs, asteroid, pos.x, pos.y);
   }
 }
 
 void draw_powerups(GameState *gs) {
   Cell p = (Cell){
       .content = '@', .text_color = FG_GREEN, .background_color = BG_BLACK};
-  Int2 *pos = NULL;
   for (size_t i = 0; i < vec_length(gs->powerups); i++) {
-    pos = *vec_at(gs->powerups, i);
-    if (is_field_coordinate(gs, pos->x, pos->y)) {
-      *field_cell_at(gs, pos->x, pos->y) = p;
+    Int2 pos = drift_pos(gs, *vec_at(gs->powerups, i));
+    if (is_field_coordinate(gs, pos.x, pos.y)) {
+      *field_cell_at(gs, pos.x, pos.y) = p;
     }
   }
 }
@@ -129,41 +322,53 @@ void draw_mines(GameState *gs) {
   Cell p = (Cell){.content = 'X',
                   .text_color = FG_HI_MAGENTA,
                   .background_color = BG_BLACK};
-  Int2 *pos = NULL;
   for (size_t i = 0; i < vec_length(gs->mines); i++) {
-    pos = *vec_at(gs->mines, i);
-    if (is_field_coordinate(gs, pos->x, pos->y)) {
-      *field_cell_at(gs, pos->x, pos->y) = p;
+    Int2 pos = drift_pos(gs, *vec_at(gs->mines, i));
+    if (is_field_coordinate(gs, pos.x, pos.y)) {
+      *field_cell_at(gs, pos.x, pos.y) = p;
+    }
+  }
+}
+
+/* Explosions are removed when they would reach this age. */
+#define EXPLOSION_AGES 6
+
+/* Returns the sprite of an explosion of age `age`: a single cell at the
+ * origin for age 0, afterwards four cells flying apart, twice as fast
+ * horizontally as vertically. The sprites are built on first use.
+ */
+static const Sprite *explosion_sprite(int age) {
+  static Sprite *sprites[EXPLOSION_AGES] = {NULL};
+  if (sprites[age] == NULL) {
+    Cell exp = (Cell){
+        .content = '#', .text_color = FG_YELLOW, .background_color = BG_HI_RED};
+    char rows[2 * EXPLOSION_AGES][4 * EXPLOSION_AGES];
+    const char *row_ptrs[2 * EXPLOSION_AGES];
+    int width = 4 * age + 1;
+    int height = 2 * age + 1;
+    for (int y = 0; y < height; y++) {
+      memset(rows[y], '.', width);
+      rows[y][width] = 0;
+      row_ptrs[y] = rows[y];
+    }
+    if (age == 0) {
+      rows[0][0] = '#';
+    } else {
+      rows[0][2 * age] = '#';
+      rows[age][0] = '#';
+      rows[age][4 * age] = '#';
+      rows[2 * age][2 * age] = '#';
     }
+    sprites[age] = sprite_new(row_ptrs, height, 2 * age, age, "#", &exp);
   }
+  return sprites[age];
 }
 
 void draw_explosions(GameState *gs) {
-  Cell exp = (Cell){
-      .content = '#', .text_color = FG_YELLOW, .background_color = BG_HI_RED};
   Explosion *e = NULL;
-  size_t x = 0;
-  size_t y = 0;
   for (size_t i = 0; i < vec_length(gs->explosions); i++) {
     e = *vec_at(gs->explosions, i);
-    x = e->pos.x;
-    y = e->pos.y;
-    if (e->age == 0) {
-      *field_cell_at(gs, x, y) = exp;
-    } else {
-      if (is_field_coordinate(gs, x + (e->age * 2), y)) {
-        *field_cell_at(gs, x + (e->age * 2), y) = exp;
-      }
-      if (is_field_coordinate(gs, x - (e->age * 2), y)) {
-        *field_cell_at(gs, x - (e->age * 2), y) = exp;
-      }
-      if (is_field_coordinate(gs, x, y + e->age)) {
-        *field_cell_at(gs, x, y + e->age) = exp;
-      }
-      if (is_field_coordinate(gs, x, y - e->age)) {
-        *field_cell_at(gs, x, y - e->age) = exp;
-      }
-    }
+    draw_sprite(gs, explosion_sprite(e->age), e->pos.x, e->pos.y);
   }
 }
 
@@ -241,40 +446,26 @@ void move_projectiles(GameState *gs) {
   }
 }
 
-void move_asteroids(GameState *gs) {
-  Int2 *ppos = NULL;
-  int s = round(gs->asteroid_speed);
-  if (gs->time_step % (5 - s) == 0) {
-    for (size_t i = 0; i < vec_length(gs->asteroids); i++) {
-      ppos = *vec_at(gs->asteroids, i);
-      ppos->x -= 1;
-      if (!is_field_coordinate(gs, ppos->x, ppos->y)) {
-        vec_remove(gs->asteroids, i);
-      }
-    }
+/* Remove the powerups or mines in `objects` which left the game field. They
+ * leave it in the order in which they spawned, because they all drift at the
+ * same speed, so only the oldest ones have to be checked. */
+static void remove_drifted_out(GameState *gs, Vec *objects) {
+  while (vec_length(objects) > 0 &&
+         !drift_is_inside_field(*vec_at(objects, 0), gs)) {
+    vec_remove(objects, 0);
   }
 }
 
-void move_powerups(GameState *gs) {
-  Int2 *ppos = NULL;
-  for (size_t i = 0; i < vec_length(gs->powerups); i++) {
-    ppos = *vec_at(gs->powerups, i);
-    ppos->x -= 1;
-    if (!is_field_coordinate(gs, ppos->x, ppos->y)) {
-      vec_remove(gs->powerups, i);
-    }
-  }
-}
-
-void move_mines(GameState *gs) {
-  Int2 *ppos = NULL;
-  for (size_t i = 0; i < vec_length(gs->mines); i++) {
-    ppos = *vec_at(gs->mines, i);
-    ppos->x -= 1;
-    if (!is_field_coordinate(gs, ppos->x, ppos->y)) {
-      vec_remove(gs->mines, i);
-    }
-  }
+void move_drifting_objects(GameState *gs) {
+  /* The speed of each asteroid only differs from `asteroid_speed` by a
+   * constant, so advancing the clocks moves all objects at once. Asteroids
+   * overtake each other, so they do not leave the field in the order in which
+   * they spawned. Instead of another pass over all of them, the ship collision
+   * check, which computes every position anyway, removes those which left. */
+  gs->drift_steps++;
+  gs->asteroid_distance += gs->asteroid_speed;
+  remove_drifted_out(gs, gs->powerups);
+  remove_drifted_out(gs, gs->mines);
 }
 
 void move_explosions(GameState *gs) {
@@ -282,71 +473,78 @@ void move_explosions(GameState *gs) {
   for (size_t i = 0; i < vec_length(gs->explosions); i++) {
     e = *vec_at(gs->explosions, i);
     e->age += 1;
-    if (e->age > 5) {
+    if (e->age >= EXPLOSION_AGES) {
       vec_remove(gs->explosions, i);
     }
   }
 }
 
+/* Push a new object at `row` in the rightmost column of the game field to
+ * `objects`. The object is `size` bytes big and starts with its `Spawn`, the
+ * rest is zeroed. */
+static void *spawn_at(GameState *gs, Vec *objects, int row, size_t size) {
+  Spawn *s = calloc(1, size);
+  if (s == NULL) {
+    exit(1);
+  }
+  s->origin = (Int2){gs->field_size.x - 1, row};
+  s->drift_steps = gs->drift_steps;
+  vec_push(objects, s);
+  return s;
+}
+
+/* Spawn a new object in each row of the rightmost column of the game field
+ * with a probability of 1 / `one_in`. Instead of deciding every row, we jump
+ * from one spawning row to the next, so the work depends on how many objects
+ * spawn and not on the height of the field. */
+static void spawn_in_rows(GameState *gs, Vec *objects, uint32_t one_in,
+                          size_t size) {
+  uint64_t rows = gs->field_size.y;
+  for (uint64_t row = rng_skip(&gs->rng, one_in); row < rows;
+       row += 1 + rng_skip(&gs->rng, one_in)) {
+    spawn_at(gs, objects, row, size);
+  }
+}
+
 void spawn_asteroids(GameState *gs) {
   if (gs->time_step % 5 == 0) {
-    for (size_t i = 0; i < gs->field_size.y; i++) {
-      int x = rand() % 49;
-      if (x == 0) {
-        Int2 *ast = malloc(sizeof(Int2));
-        if (ast == NULL) {
-          exit(1);
-        } else {
-          ast->x = gs->field_size.x - 1;
-          ast->y = i;
-          vec_push(gs->asteroids, ast);
-        }
-      }
+    size_t first = vec_length(gs->asteroids);
+    spawn_in_rows(gs, gs->asteroids, 49, sizeof(Asteroid));
+    for (size_t i = first; i < vec_length(gs->asteroids); i++) {
+      Asteroid *a = *vec_at(gs->asteroids, i);
+      a->spawn_distance = gs->asteroid_distance;
+      a->speed = (int)rng_below(&gs->rng, 2 * ASTEROID_SPEED_SPREAD + 1) -
+                 ASTEROID_SPEED_SPREAD;
     }
   }
 }
 
 void spawn_powerups(GameState *gs) {
-  int x = rand() % 199;
-  if (x == 0) {
-    int x = rand() % gs->field_size.y - 1;
-    Int2 *pu = malloc(sizeof(Int2));
-    if (pu == NULL) {
-      exit(1);
-    } else {
-      pu->x = gs->field_size.x - 1;
-      pu->y = x;
-      vec_push(gs->powerups, pu);
-    }
+  if (rng_chance(&gs->rng, 199)) {
+    spawn_at(gs, gs->powerups, rng_below(&gs->rng, gs->field_size.y),
+             sizeof(Spawn));
   }
 }
 
 void spawn_mines(GameState *gs) {
   if (gs->time_step % 5 == 0) {
-    for (size_t i = 0; i < gs->field_size.y; i++) {
-      int x = rand() % 999;
-      if (x == 0) {
-        Int2 *pu = malloc(sizeof(Int2));
-        if (pu == NULL) {
-          exit(1);
-        } else {
-          pu->x = gs->field_size.x - 1;
-          pu->y = i;
-          vec_push(gs->mines, pu);
-        }
-      }
-    }
+    spawn_in_rows(gs, gs->mines, 999, sizeof(Spawn));
   }
 }
 
 void handle_projectile_asteroid_collisions(GameState *gs) {
+  /* Most of the time no projectile is flying, so there is no need to compute
+   * the position of every asteroid. */
+  if (vec_length(gs->projectiles) == 0) {
+    return;
+  }
   Int2 *ppos = NULL;
-  Int2 *apos = NULL;
-  for (size_t i = 0; i < vec_length(gs->asteroids); i++) {
-    apos = *vec_at(gs->asteroids, i);
-    for (size_t j = 0; j < vec_length(gs->projectiles); j++) {
+  for (size_t i = 0; i < vec_length(gs->asteroids);) {
+    Int2 apos = asteroid_pos(gs, *vec_at(gs->asteroids, i));
+    bool hit = false;
+    for (size_t j = 0; j < vec_length(gs->projectiles) && !hit; j++) {
       ppos = *vec_at(gs->projectiles, j);
-      if (apos->x == ppos->x && apos->y == ppos->y) {
+      if (apos.x == ppos->x && apos.y == ppos->y) {
         gs->points += 5;
         Explosion *exp = malloc(sizeof(Explosion));
         if (exp == NULL) {
@@ -360,17 +558,20 @@ void handle_projectile_asteroid_collisions(GameState *gs) {
         vec_remove(gs->asteroids, i);
         vec_remove(gs->projectiles, j);
         gs->points++;
-        apos = *vec_at(gs->projectiles, j);
+        hit = true;
       }
     }
+    /* If the asteroid was hit, the next one has moved to index `i`. */
+    if (!hit) {
+      i++;
+    }
   }
 }
 
 void handle_powerup_ship_collisions(GameState *gs) {
-  Int2 *apos = NULL;
   for (size_t i = 0; i < vec_length(gs->powerups); i++) {
-    apos = *vec_at(gs->powerups, i);
-    if (collides_with_ship(gs->ship.pos, *apos)) {
+    Int2 pos = drift_pos(gs, *vec_at(gs->powerups, i));
+    if (collides_with_ship(gs->ship.pos, pos)) {
       gs->points += 50;
       vec_remove(gs->powerups, i);
       gs->ship.powerup_time = 1000;
@@ -379,24 +580,32 @@ void handle_powerup_ship_collisions(GameState *gs) {
 }
 
 void handle_mines_ship_collisions(GameState *gs) {
-  Int2 *mine = NULL;
   for (size_t i = 0; i < vec_length(gs->mines); i++) {
-    mine = *vec_at(gs->mines, i);
-    if (collides_with_ship(gs->ship.pos, *mine)) {
+    Int2 mine = drift_pos(gs, *vec_at(gs->mines, i));
+    if (collides_with_ship(gs->ship.pos, mine)) {
       gs->points -= 100;
       vec_remove(gs->mines, i);
-      gs->asteroid_speed = (gs->asteroid_speed == 4) ? gs->asteroid_speed : 4;
+      gs->asteroid_speed = ASTEROID_MINE_SPEED;
     }
   }
 }
 
+/* `vec_retain` callback which keeps the asteroids `a` which are still inside
+ * the field of `gs` and did not collide with its ship. A collision costs the
+ * ship one health. */
+static bool asteroid_misses_ship(void *a, void *gs) {
+  GameState *g = gs;
+  Int2 pos = asteroid_pos(g, a);
+  if (!is_field_coordinate(g, pos.x, pos.y)) {
+    return false;
+  }
+  if (collides_with_ship(g->ship.pos, pos)) {
+    g->ship.health -= 1;
+    return false;
+  }
+  return true;
+}
+
 void handle_asteroid_ship_collisions(GameState *gs) {
-  Int2 *apos = NULL;
-  for (size_t i = 0; i < vec_length(gs->asteroids); i++) {
-    apos = *vec_at(gs->asteroids, i);
-    if (collides_with_ship(gs->ship.pos, *apos)) {
-      vec_remove(gs->asteroids, i);
-      gs->ship.health -= 1;
-    }
-  }
+  vec_retain(gs->asteroids, asteroid_misses_ship, gs);
 }
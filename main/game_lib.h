@@ -2,6 +2,7 @@
 #define GAME_LIB_H
 
 #include "../tui/tui.h"
+#include "./rng.h"
 #include "./vec.h"
 
 /** DATA STRUCTURES ***********************************************************/
@@ -11,6 +12,27 @@ typedef struct Int2 {
   int y;
 } Int2;
 
+/* Fixed-point numbers in 1/FIX_ONE cells, for positions and speeds between
+ * whole cells. */
+#define FIX_SHIFT 16
+#define FIX_ONE (1 << FIX_SHIFT)
+
+/* Where and when an object spawned. Objects which drift to the left at a known
+ * speed, i.e. asteroids, powerups and mines, are not moved in every time step,
+ * their position is computed from this when it is needed. */
+typedef struct Spawn {
+  Int2 origin;     /* The cell in which the object spawned in field
+                      coordinates. */
+  int drift_steps; /* `drift_steps` of the game when the object spawned. */
+} Spawn;
+
+typedef struct Asteroid {
+  Spawn spawn;
+  int64_t spawn_distance; /* `asteroid_distance` when the asteroid spawned. */
+  int speed; /* How much faster than `asteroid_speed` this asteroid flies, in
+                1/FIX_ONE cells per time step. Slow asteroids are negative. */
+} Asteroid;
+
 typedef struct Explosion {
   Int2 pos; /* Position where the explosion originally started in field
                coordinates. */
@@ -37,26 +59,110 @@ typedef struct GameState {
                        asteroids and collecting powerups. */
   Vec *projectiles; /* The positions of the currently active projectiles in
                        field coordinates. */
-  Vec *asteroids;   /* The positions of the currently active asteroids in field
-                       coordinates. */
-  Vec *powerups;    /* The positions of the currently active powerups in field
-                       coordinates. */
+  Vec *asteroids;   /* The currently active `Asteroid`s. */
+  Vec *powerups;    /* The `Spawn`s of the currently active powerups. */
   Vec *explosions;  /* The currently active `Explosion`s. */
   int time_step; /* How many iterations the while-loop in game.c has already run
                     through. */
-  Vec *mines;    /* increasing the asteroid speed, when colliding with ship */
-
-  double asteroid_speed; /* will determine the asteroid movement steps */
+  Vec *mines;    /* The `Spawn`s of the currently active mines, which increase
+                    the asteroid speed when colliding with the ship. */
+
+  int asteroid_speed; /* How many 1/FIX_ONE cells the asteroids fly to the left
+                         per time step. Increased by mines, afterwards it
+                         slowly decreases again. */
+  int drift_steps; /* How often asteroids, powerups and mines have moved to
+                      the left since the game started. */
+  int64_t asteroid_distance; /* How many 1/FIX_ONE cells the asteroids have
+                                flown to the left at `asteroid_speed` since
+                                the game started. */
+
+  Rng rng; /* Decides where and when objects spawn. */
+
+  Hud info_bar;        /* The fields below the game field. */
+  bool info_bar_ready; /* False if `info_bar` has to be laid out again, e.g.
+                          because the terminal was resized. */
 } GameState;
 
+/** LAYOUT ********************************************************************/
+
+/* Lay out the game field for a terminal of size `term_size`: the field is
+ * surrounded by the frame and leaves space for the info bar below.
+ *
+ * The ship is moved back into the field, and all other objects outside of it
+ * are removed. The frame has to be drawn again with `draw_frame`, the info bar
+ * is laid out again by the next `draw_info_bar`. */
+void resize_field(GameState *gs, Size2 term_size);
+
+/** GAME LOOP *****************************************************************/
+
+/* Start a new game on a terminal of size `term_size`. The ship is positioned
+ * left to the center of the game field. Nothing is drawn, so this also works
+ * without `tui_init`.
+ *
+ * Games with the same `seed` and the same input play out exactly the same. */
+void game_init(GameState *gs, Size2 term_size, uint64_t seed);
+
+/* Free the vectors of `gs` and the objects in them. */
+void game_free(GameState *gs);
+
+/* Simulate the current time step after the input was handled: move, spawn
+ * and collide all objects. Returns true if the ship was destroyed. */
+bool game_update(GameState *gs);
+
+/* Advance to the next time step, after the current one was drawn. */
+void game_next_step(GameState *gs);
+
+/* Clear the entity layer and draw the info bar and all objects. */
+void draw_game(GameState *gs);
+
+/** FRAME PACING **************************************************************/
+
+/* How many due frames in a row may be skipped while the game catches up on
+ * overdue time steps. The next one is rendered anyway, so the screen keeps
+ * changing even if the game never catches up. */
+#define MAX_SKIPPED_FRAMES 5
+
+/* Decides in which time steps a frame is rendered. */
+typedef struct FramePacer {
+  int fps;      /* How many frames are rendered per `sim_rate` time steps. */
+  int sim_rate; /* How many time steps are simulated per second. */
+  int credit;   /* Each time step adds `fps`, and a frame is due whenever the
+                   credit reaches `sim_rate`. */
+  int skipped_in_row; /* Due frames skipped since the last rendered one. */
+  uint64_t skipped;   /* All due frames which were skipped. */
+} FramePacer;
+
+/* Start pacing `fps` frames per `sim_rate` time steps. The credit starts full,
+ * so the first time step is rendered. */
+void frame_pacer_init(FramePacer *p, int fps, int sim_rate);
+
+/* Returns true iff the current time step is rendered. Call once per time step.
+ *
+ * Frames are spread evenly over the time steps. If `catching_up` is true, a
+ * due frame is skipped to save time, but at most `MAX_SKIPPED_FRAMES` in a
+ * row. */
+bool frame_pacer_step(FramePacer *p, bool catching_up);
+
+/** POSITIONS *****************************************************************/
+
+/* Returns the current cell of asteroid `a`. */
+Int2 asteroid_pos(const GameState *gs, const Asteroid *a);
+
+/* Returns the current cell of a powerup or mine which spawned at `s`. They
+ * drift one cell to the left per time step. */
+Int2 drift_pos(const GameState *gs, const Spawn *s);
+
 /** DRAWING *******************************************************************/
 
 /* Draws the info data below the game field (ship's health, points, distance,
- * remaining powerup time). */
+ * remaining powerup time) on the HUD layer, if it has changed since the last
+ * call. */
 void draw_info_bar(GameState *gs);
 
 /* Draws a white border *around* the game field (area between `field_begin` and
- * `field_end`). */
+ * `field_end`) on the static layer, replacing any border drawn before. The
+ * border stays visible until the layer is cleared, so it only has to be drawn
+ * once per layout. */
 void draw_frame(GameState *gs);
 
 /* Like `tui_cell_at` but uses (x,y) coordinates, which are relative to
@@ -66,6 +172,10 @@ Cell *field_cell_at(GameState *gs, int x, int y);
 /* Returns true iff (x,y) are valid game field coordinates. */
 bool is_field_coordinate(GameState *gs, int x, int y);
 
+/* Draws sprite `s` on the entity layer with its origin at the field
+ * coordinates (x,y). Cells outside of the game field are not drawn. */
+void draw_sprite(GameState *gs, const Sprite *s, int x, int y);
+
 /* Draws the ship at it's current position. */
 void draw_ship(GameState *gs);
 
@@ -88,22 +198,20 @@ bool handle_input(GameState *gs, char c);
 
 /** SIMULATING ANOTHER GAME STEP **********************************************/
 
-/* Move all asteroids one step to the left, if the time step is divisible by 5,
- * otherwise do nothing. Asteroids, which would leave the game field, are
- * removed.
+/* Move all asteroids, powerups and mines to the left: asteroids by their
+ * speed, which may be less than a cell, powerups and mines by one cell. Only
+ * `drift_steps` and `asteroid_distance` are advanced, see `asteroid_pos` and
+ * `drift_pos`. Powerups and mines, which would leave the game field, are
+ * removed. Asteroids which left it are removed by
+ * `handle_asteroid_ship_collisions`.
  */
-void move_asteroids(GameState *gs);
+void move_drifting_objects(GameState *gs);
 
 /* Move all projectiles one step to the right.
  * Projectiles, which would leave the game field, are removed.
  */
 void move_projectiles(GameState *gs);
 
-/* Move all powerups one step to the left.
- * Powerups, which would leave the game field, are removed.
- */
-void move_powerups(GameState *gs);
-
 /* Increment the age of all explosions by one.
  * Explosions, which would reach age == 6, are removed.
  */
@@ -133,13 +241,12 @@ void handle_powerup_ship_collisions(GameState *gs);
 
 /* Check if the ship collides with an asteroid. For each asteroid which collides
  * with the ship, the asteroid is removed and the ship's health is reduced by 1.
+ * Asteroids which left the game field are removed as well.
  */
 void handle_asteroid_ship_collisions(GameState *gs);
 
 void draw_mines(GameState *gs);
 
-void move_mines(GameState *gs);
-
 void spawn_mines(GameState *gs);
 
 void handle_mines_ship_collisions(GameState *gs);
@@ -1,9 +1,264 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
 #include "../unity/unity.h"
 
+#include "../tui/tui_diff.h"
+#include "../tui/tui_encoder.h"
 #include "./game_lib.h"
 
 void setUp(void) {}
 
+/* What a terminal shows in a cell. Colors are SGR numbers, -1 is the default
+ * color of the terminal. */
+typedef struct ScreenCell {
+  char content;
+  int text_color;
+  int background_color;
+  int attributes; /* Bold and underline as the bits 1 << 1 and 1 << 4. */
+} ScreenCell;
+
+/* A terminal which understands the ANSI codes the encoder prints, so tests
+ * can check what the terminal shows, not only which codes were printed. */
+typedef struct Screen {
+  size_t width;
+  size_t height;
+  ScreenCell *cells;
+  size_t x;
+  size_t y;
+  bool wrap_pending; /* A character was printed into the last column, so the
+                        next one goes to the start of the next row. */
+  ScreenCell pen;    /* The active colors and the character REP repeats. */
+  int unknown_codes; /* Codes the screen does not understand. */
+} Screen;
+
+static const ScreenCell default_pen = {
+    .content = ' ', .text_color = -1, .background_color = -1};
+
+/* Start with cells which no frame shows, so unprinted cells are noticed. */
+static void screen_init(Screen *s, size_t width, size_t height) {
+  *s = (Screen){.width = width, .height = height, .pen = default_pen};
+  s->cells = calloc(width * height, sizeof(ScreenCell));
+}
+
+/* An ANSI code `ESC[` with up to 8 parameters, -1 if left out. */
+typedef struct Csi {
+  bool private; /* Starts with `ESC[?`. */
+  int params[8];
+  int count;
+  char final;
+} Csi;
+
+/* Parse the ANSI code at the start of the `n` bytes at `data`. Returns how
+ * many bytes it has, or 0 if it is not a complete `ESC[` code. */
+static size_t parse_csi(const char *data, size_t n, Csi *c) {
+  if (n < 3 || data[0] != '\e' || data[1] != '[') {
+    return 0;
+  }
+  *c = (Csi){.count = 0};
+  size_t i = 2;
+  if (data[i] == '?') {
+    c->private = true;
+    i++;
+  }
+  int value = -1;
+  for (; i < n && ((data[i] >= '0' && data[i] <= '9') || data[i] == ';'); i++) {
+    if (data[i] == ';') {
+      if (c->count < 8) {
+        c->params[c->count++] = value;
+      }
+      value = -1;
+    } else {
+      value = (value < 0 ? 0 : value * 10) + data[i] - '0';
+    }
+  }
+  if (i >= n) {
+    return 0;
+  }
+  if ((value >= 0 || c->count > 0) && c->count < 8) {
+    c->params[c->count++] = value;
+  }
+  c->final = data[i];
+  return i + 1;
+}
+
+/* Returns parameter `i` of `c`, or `def` if it is left out or 0. */
+static int csi_param(const Csi *c, int i, int def) {
+  return i < c->count && c->params[i] > 0 ? c->params[i] : def;
+}
+
+static void apply_sgr(ScreenCell *pen, const Csi *c) {
+  for (int i = 0; i < (c->count > 0 ? c->count : 1); i++) {
+    int p = i < c->count && c->params[i] > 0 ? c->params[i] : 0;
+    if (p == 0) {
+      *pen = (ScreenCell){.content = pen->content,
+                          .text_color = -1,
+                          .background_color = -1};
+    } else if (p == 1 || p == 4) {
+      pen->attributes |= 1 << p;
+    } else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97)) {
+      pen->text_color = p;
+    } else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107)) {
+      pen->background_color = p;
+    }
+  }
+}
+
+/* Returns how the terminal shows `c`. */
+static ScreenCell shown_cell(const Cell *c) {
+  ScreenCell pen = default_pen;
+  Csi code;
+  if (parse_csi(c->text_color, strlen(c->text_color), &code)) {
+    apply_sgr(&pen, &code);
+  }
+  if (parse_csi(c->background_color, strlen(c->background_color), &code)) {
+    apply_sgr(&pen, &code);
+  }
+  pen.content = c->content;
+  return pen;
+}
+
+static ScreenCell *screen_cell(Screen *s, size_t x, size_t y) {
+  return s->cells + y * s->width + x;
+}
+
+/* A blank cell as erased, deleted or inserted with the active colors. */
+static ScreenCell blank_cell(const Screen *s) {
+  ScreenCell c = s->pen;
+  c.content = ' ';
+  return c;
+}
+
+static void screen_put(Screen *s, char content) {
+  if (s->wrap_pending) {
+    s->x = 0;
+    if (s->y + 1 < s->height) {
+      s->y++;
+    } else {
+      /* The encoder never scrolls the terminal. */
+      s->unknown_codes++;
+    }
+    s->wrap_pending = false;
+  }
+  s->pen.content = content;
+  *screen_cell(s, s->x, s->y) = s->pen;
+  if (s->x + 1 < s->width) {
+    s->x++;
+  } else {
+    s->wrap_pending = true;
+  }
+}
+
+static void screen_csi(Screen *s, const Csi *c) {
+  size_t n = csi_param(c, 0, 1);
+  ScreenCell *row = screen_cell(s, 0, s->y);
+  if (c->private) {
+    /* Modes like synchronized output do not change the cells. */
+    if (c->final != 'h' && c->final != 'l') {
+      s->unknown_codes++;
+    }
+    return;
+  }
+  switch (c->final) {
+    case 'm':
+      apply_sgr(&s->pen, c);
+      return;
+    case 'b':
+      for (size_t i = 0; i < n; i++) {
+        screen_put(s, s->pen.content);
+      }
+      return;
+    case 'H':
+      s->y = csi_param(c, 0, 1) - 1;
+      s->x = csi_param(c, 1, 1) - 1;
+      s->y = s->y < s->height ? s->y : s->height - 1;
+      s->x = s->x < s->width ? s->x : s->width - 1;
+      break;
+    case 'A':
+      s->y = s->y >= n ? s->y - n : 0;
+      break;
+    case 'B':
+      s->y = s->y + n < s->height ? s->y + n : s->height - 1;
+      break;
+    case 'C':
+      s->x = s->x + n < s->width ? s->x + n : s->width - 1;
+      break;
+    case 'D':
+      s->x = s->x >= n ? s->x - n : 0;
+      break;
+    case 'X':
+      for (size_t x = s->x; x < s->x + n && x < s->width; x++) {
+        row[x] = blank_cell(s);
+      }
+      break;
+    case 'P':
+      n = n < s->width - s->x ? n : s->width - s->x;
+      memmove(row + s->x, row + s->x + n,
+              (s->width - s->x - n) * sizeof(ScreenCell));
+      for (size_t x = s->width - n; x < s->width; x++) {
+        row[x] = blank_cell(s);
+      }
+      break;
+    case '@':
+      n = n < s->width - s->x ? n : s->width - s->x;
+      memmove(row + s->x + n, row + s->x,
+              (s->width - s->x - n) * sizeof(ScreenCell));
+      for (size_t x = s->x; x < s->x + n; x++) {
+        row[x] = blank_cell(s);
+      }
+      break;
+    default:
+      s->unknown_codes++;
+      break;
+  }
+  s->wrap_pending = false;
+}
+
+/* Let the screen process the `n` bytes at `data`. */
+static void screen_feed(Screen *s, const char *data, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    Csi c;
+    size_t len = parse_csi(data + i, n - i, &c);
+    if (len > 0) {
+      screen_csi(s, &c);
+      i += len;
+    } else if (data[i] == '\r') {
+      s->x = 0;
+      s->wrap_pending = false;
+      i++;
+    } else if ((unsigned char)data[i] >= ' ' && data[i] != 0x7f) {
+      screen_put(s, data[i]);
+      i++;
+    } else {
+      s->unknown_codes++;
+      i++;
+    }
+  }
+}
+
+/* Returns the index of the first cell which `s` shows differently than `m`,
+ * or -1 if it shows all cells of `m`. Spaces only show their background. */
+static long screen_mismatch(Screen *s, Matrix *m) {
+  for (size_t y = 0; y < s->height; y++) {
+    for (size_t x = 0; x < s->width; x++) {
+      ScreenCell want = shown_cell(matrix_cell_at(m, x, y));
+      ScreenCell have = *screen_cell(s, x, y);
+      bool same = want.content == have.content &&
+                  want.background_color == have.background_color &&
+                  (want.content == ' ' ||
+                   (want.text_color == have.text_color &&
+                    want.attributes == have.attributes));
+      if (!same) {
+        return y * s->width + x;
+      }
+    }
+  }
+  return -1;
+}
+
 void test_collision_with_ship(void) {
   Int2 s = {.x = 0, .y = 2};
   Int2 a1 = {.x = 0, .y = 0};
@@ -22,10 +277,738 @@ void test_collision_with_ship(void) {
     }
   }
 }
+
+void test_diff_kernels_agree(void) {
+  /* Rows up to 100 cells cover the 64 and 32 byte loops of the AVX2 kernel,
+   * the SSE2 loop and the 8 byte and single byte tails. */
+  enum { MAX_CELLS = 100 };
+  Cell *a = calloc(MAX_CELLS, sizeof(Cell));
+  Cell *b = calloc(MAX_CELLS, sizeof(Cell));
+  unsigned char *bytes = (unsigned char *)b;
+  DiffKernel kernels[] = {DIFF_KERNEL_SCALAR, DIFF_KERNEL_SSE2,
+                          DIFF_KERNEL_AVX2};
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!cells_diff_use_kernel(kernels[k])) {
+      continue;
+    }
+    for (size_t n = 1; n <= MAX_CELLS; n++) {
+      TEST_ASSERT_EQUAL(n, cells_find_diff(a, b, 0, n));
+      /* A difference in any byte is found in its cell, and differences
+       * behind the range are ignored. */
+      for (size_t i = 0; i < n * sizeof(Cell); i++) {
+        bytes[i] = 1;
+        TEST_ASSERT_EQUAL(i / sizeof(Cell), cells_find_diff(a, b, 0, n));
+        TEST_ASSERT_EQUAL(n, cells_find_diff(a, b, i / sizeof(Cell) + 1, n));
+        bytes[i] = 0;
+      }
+    }
+  }
+  /* Back to the fastest kernel for the other tests. */
+  if (!cells_diff_use_kernel(DIFF_KERNEL_AVX2)) {
+    cells_diff_use_kernel(DIFF_KERNEL_SSE2);
+  }
+  free(a);
+  free(b);
+}
+
+void test_render_into_memory_sink(void) {
+  /* The statistics and the memory start over with every `tui_init`. */
+  for (int run = 0; run < 2; run++) {
+    tui_init((TuiConfig){.sink = TUI_SINK_MEMORY, .size = {40, 20}});
+    GameState gs = {.term_size = {40, 20},
+                    .field_begin = {1, 1},
+                    .field_end = {39, 17},
+                    .field_size = {38, 16}};
+    TEST_ASSERT_EQUAL(0, tui_stats().frames);
+    TEST_ASSERT_EQUAL(0, tui_memory()->length);
+
+    /* The first frame has to print every cell. */
+    draw_frame(&gs);
+    tui_present();
+    TuiStats first = tui_stats();
+    TEST_ASSERT_EQUAL(1, first.frames);
+    TEST_ASSERT_EQUAL(40 * 20, first.cells);
+
+    /* Nothing has changed, so no cell has to be printed again. */
+    tui_present();
+    TuiStats second = tui_stats();
+    TEST_ASSERT_EQUAL(0, second.cells - first.cells);
+    TEST_ASSERT_EQUAL(tui_memory()->length, second.bytes);
+
+    tui_shutdown();
+    TEST_ASSERT_EQUAL(2, tui_stats().frames);
+  }
+}
+
+void test_redraw_cells_in_place(void) {
+  tui_init((TuiConfig){.sink = TUI_SINK_MEMORY, .size = {20, 5}});
+  Cell blank = {.content = ' ', .text_color = FG_WHITE,
+                .background_color = BG_BLACK};
+  Matrix *want = matrix_new(20, 5, &blank);
+  Screen screen;
+  screen_init(&screen, 20, 5);
+  size_t replayed = 0;
+  for (int frame = 0; frame < 4; frame++) {
+    /* The HUD cell is drawn again without clearing the layer, the entity
+     * moves, and a cell drawn twice in one frame shows the second one. */
+    Cell hud = {.content = 'a' + frame, .text_color = FG_RED,
+                .background_color = BG_BLACK};
+    *tui_layer_cell_at(TUI_LAYER_HUD, 3, 4) = hud;
+    tui_clear();
+    matrix_clear_with(want, &blank);
+    *matrix_cell_at(want, 3, 4) = hud;
+    Cell entity = {.content = '#', .text_color = FG_WHITE,
+                   .background_color = BG_BLUE};
+    *tui_cell_at(10 - frame, 1) = blank;
+    *tui_cell_at(10 - frame, 1) = entity;
+    *matrix_cell_at(want, 10 - frame, 1) = entity;
+    tui_present();
+
+    Buffer *out = tui_memory();
+    screen_feed(&screen, out->data + replayed, out->length - replayed);
+    replayed = out->length;
+    TEST_ASSERT_EQUAL(-1, screen_mismatch(&screen, want));
+  }
+  free(screen.cells);
+  matrix_free(want);
+  tui_shutdown();
+}
+
+/* Returns the content of row `y` of the HUD layer, '.' for transparent
+ * cells. */
+static const char *hud_row(size_t y, size_t width) {
+  static char row[81];
+  for (size_t x = 0; x < width && x < 80; x++) {
+    char c = layer_get(tui_canvas.layers[TUI_LAYER_HUD], x, y)->content;
+    row[x] = c != 0 ? c : '.';
+  }
+  row[width < 80 ? width : 80] = 0;
+  return row;
+}
+
+void test_hud_draws_only_changes(void) {
+  tui_init((TuiConfig){.sink = TUI_SINK_MEMORY, .size = {30, 2}});
+  Hud hud;
+  hud_init(&hud, 1, 1, 30, 2, FG_WHITE, BG_BLACK);
+  size_t a = hud_add_field(&hud, "A:");
+  size_t b = hud_add_field(&hud, "B:");
+  hud_set(&hud, b, -7);
+  hud_draw(&hud);
+  tui_present();
+  TEST_ASSERT_EQUAL_STRING(".A:0  B:-7....................", hud_row(1, 30));
+
+  /* Setting the same values draws nothing. */
+  uint64_t cells = tui_stats().cells;
+  hud_set(&hud, a, 0);
+  hud_set(&hud, b, -7);
+  hud_draw(&hud);
+  tui_present();
+  TEST_ASSERT_EQUAL(cells, tui_stats().cells);
+
+  /* More digits move the fields behind, fewer leave transparent cells. */
+  hud_set(&hud, a, 1234);
+  hud_draw(&hud);
+  TEST_ASSERT_EQUAL_STRING(".A:1234  B:-7.................", hud_row(1, 30));
+  hud_set(&hud, a, 5);
+  hud_set(&hud, b, LONG_MIN);
+  hud_draw(&hud);
+  TEST_ASSERT_EQUAL_STRING(".A:5  B:-9223372036854775808..", hud_row(1, 30));
+  hud_set(&hud, b, 3);
+  hud_draw(&hud);
+  TEST_ASSERT_EQUAL_STRING(".A:5  B:3.....................", hud_row(1, 30));
+  tui_shutdown();
+}
+
+/* Clear `out`, move the cursor of `e` to (x, y) and return the codes. */
+static const char *move(Encoder *e, Matrix *m, size_t x, size_t y) {
+  buffer_clear(e->out);
+  encoder_move_to(e, m, x, y);
+  buffer_append_char(e->out, 0);
+  return e->out->data;
+}
+
+void test_cursor_moves(void) {
+  Cell blank = {.content = ' ', .text_color = FG_WHITE,
+                .background_color = BG_BLACK};
+  Matrix *m = matrix_new(20, 5, &blank);
+  Buffer out;
+  buffer_init(&out);
+  Encoder e;
+  encoder_init(&e, &out, 0);
+
+  /* An unknown cursor is positioned absolutely, parameters which are 1 are
+   * left out. */
+  TEST_ASSERT_EQUAL_STRING("\e[H", move(&e, m, 0, 0));
+  TEST_ASSERT_EQUAL_STRING("", move(&e, m, 0, 0));
+  /* The colors are unknown, so moving is shorter than printing. */
+  TEST_ASSERT_EQUAL_STRING("\e[5C", move(&e, m, 5, 0));
+  /* Back to the first column with a carriage return. */
+  TEST_ASSERT_EQUAL_STRING("\r", move(&e, m, 0, 0));
+  TEST_ASSERT_EQUAL_STRING("\e[3B", move(&e, m, 0, 3));
+  TEST_ASSERT_EQUAL_STRING("\e[2A", move(&e, m, 0, 1));
+  TEST_ASSERT_EQUAL_STRING("\e[B", move(&e, m, 0, 2));
+  TEST_ASSERT_EQUAL_STRING("\e[15C", move(&e, m, 15, 2));
+  /* Up and back would take as long as from the first column. */
+  TEST_ASSERT_EQUAL_STRING("\e[1;4H", move(&e, m, 3, 0));
+  TEST_ASSERT_EQUAL_STRING("\e[D", move(&e, m, 2, 0));
+
+  /* Once the colors are known, a small gap is printed again. */
+  buffer_clear(&out);
+  encoder_print_cell(&e, m, 2, 2);
+  TEST_ASSERT_EQUAL_STRING("  ", move(&e, m, 5, 2));
+  TEST_ASSERT_EQUAL_STRING("\e[B\r ", move(&e, m, 1, 3));
+
+  /* After the last column, terminals differ in where the cursor is. */
+  encoder_print_cell(&e, m, 19, 3);
+  TEST_ASSERT_FALSE(e.cursor_known);
+  TEST_ASSERT_EQUAL_STRING("\e[5;4H", move(&e, m, 3, 4));
+
+  encoder_free(&e);
+  buffer_free(&out);
+  matrix_free(m);
+}
+
+/* The cells of the random frames in `test_replay_updates`. */
+static Cell random_cell(Rng *rng) {
+  const char *contents = " #o*";
+  const char *text_colors[] = {FG_WHITE, FG_RED, FG_BOLD_YELLOW};
+  const char *background_colors[] = {BG_BLACK, BG_BLUE};
+  return (Cell){.content = contents[rng_below(rng, 4)],
+                .text_color = text_colors[rng_below(rng, 3)],
+                .background_color = background_colors[rng_below(rng, 2)]};
+}
+
+/* Change `m` like a game frame: single cells, runs of equal cells and rows
+ * whose content moved one column to the left. */
+static void change_randomly(Matrix *m, Rng *rng) {
+  size_t width = matrix_width(m);
+  for (size_t y = 0; y < matrix_height(m); y++) {
+    Cell *row = matrix_cell_at(m, 0, y);
+    if (rng_chance(rng, 3)) {
+      memmove(row, row + 1, (width - 1) * sizeof(Cell));
+      row[width - 1] = random_cell(rng);
+    }
+    for (int i = rng_below(rng, 4); i > 0; i--) {
+      size_t x = rng_below(rng, width);
+      size_t n = 1 + rng_below(rng, rng_chance(rng, 2) ? 3 : 30);
+      Cell c = random_cell(rng);
+      for (; n > 0 && x < width; n--, x++) {
+        row[x] = c;
+      }
+    }
+  }
+}
+
+/* Print random frames with `caps`, alternately with `encoder_print_update`
+ * and `encoder_print_cells`, and check that the screen shows each frame. */
+static void replay_updates(unsigned caps) {
+  enum { WIDTH = 37, HEIGHT = 9 };
+  Cell unknown = {.content = 0, .text_color = "", .background_color = ""};
+  Cell blank = {.content = ' ', .text_color = FG_WHITE,
+                .background_color = BG_BLACK};
+  Matrix *old = matrix_new(WIDTH, HEIGHT, &unknown);
+  Matrix *new = matrix_new(WIDTH, HEIGHT, &blank);
+  Size2 *positions = calloc(WIDTH * HEIGHT, sizeof(Size2));
+  Screen screen;
+  screen_init(&screen, WIDTH, HEIGHT);
+  Buffer out;
+  buffer_init(&out);
+  Encoder e;
+  encoder_init(&e, &out, caps);
+  Rng rng;
+  rng_seed(&rng, caps);
+
+  for (int frame = 0; frame < 200; frame++) {
+    size_t count = 0;
+    for (size_t y = 0; y < HEIGHT; y++) {
+      for (size_t x = 0; x < WIDTH; x++) {
+        if (!cell_eq(matrix_cell_at(old, x, y), matrix_cell_at(new, x, y))) {
+          positions[count++] = (Size2){x, y};
+        }
+      }
+    }
+    buffer_clear(&out);
+    if (frame % 2 == 0) {
+      encoder_print_update(&e, old, new);
+    } else {
+      encoder_print_cells(&e, old, new, positions, count);
+    }
+    screen_feed(&screen, out.data, out.length);
+    TEST_ASSERT_EQUAL(0, screen.unknown_codes);
+    TEST_ASSERT_EQUAL(-1, screen_mismatch(&screen, new));
+
+    memcpy(old->cells, new->cells, WIDTH * HEIGHT * sizeof(Cell));
+    change_randomly(new, &rng);
+  }
+
+  encoder_free(&e);
+  buffer_free(&out);
+  free(screen.cells);
+  free(positions);
+  matrix_free(old);
+  matrix_free(new);
+}
+
+void test_replay_updates(void) {
+  replay_updates(0);
+}
+
+/* Returns how many ANSI codes with the final character `final` are in the
+ * `n` bytes at `data`. */
+static int count_codes(const char *data, size_t n, char final) {
+  int count = 0;
+  for (size_t i = 0; i < n; i++) {
+    Csi c;
+    size_t len = parse_csi(data + i, n - i, &c);
+    if (len > 0) {
+      count += c.final == final;
+      i += len - 1;
+    }
+  }
+  return count;
+}
+
+void test_runs_with_rep_and_ech(void) {
+  replay_updates(TERM_CAP_REP);
+  replay_updates(TERM_CAP_ECH);
+  replay_updates(TERM_CAP_REP | TERM_CAP_ECH);
+
+  unsigned all_caps[] = {0, TERM_CAP_REP, TERM_CAP_ECH,
+                         TERM_CAP_REP | TERM_CAP_ECH};
+  for (size_t i = 0; i < sizeof(all_caps) / sizeof(all_caps[0]); i++) {
+    unsigned caps = all_caps[i];
+    tui_init((TuiConfig){.sink = TUI_SINK_MEMORY, .size = {60, 4},
+                         .caps = caps});
+    Cell blank = {.content = ' ', .text_color = FG_WHITE,
+                  .background_color = BG_BLACK};
+    Matrix *want = matrix_new(60, 4, &blank);
+    /* A run of characters, a blue run to the end of the row and a blue run
+     * in the middle of a row. */
+    Cell hash = {.content = '#', .text_color = FG_RED,
+                 .background_color = BG_BLACK};
+    Cell blue = {.content = ' ', .text_color = FG_WHITE,
+                 .background_color = BG_BLUE};
+    for (size_t x = 5; x < 35; x++) {
+      *tui_cell_at(x, 0) = *matrix_cell_at(want, x, 0) = hash;
+    }
+    for (size_t x = 10; x < 60; x++) {
+      *tui_cell_at(x, 1) = *matrix_cell_at(want, x, 1) = blue;
+    }
+    for (size_t x = 10; x < 30; x++) {
+      *tui_cell_at(x, 2) = *matrix_cell_at(want, x, 2) = blue;
+    }
+    tui_present();
+
+    Buffer *out = tui_memory();
+    /* REP and ECH are only used if the terminal understands them. */
+    bool rep = count_codes(out->data, out->length, 'b') > 0;
+    bool ech = count_codes(out->data, out->length, 'X') > 0;
+    TEST_ASSERT_EQUAL((caps & TERM_CAP_REP) != 0, rep);
+    TEST_ASSERT_EQUAL((caps & TERM_CAP_ECH) != 0, ech);
+    /* ECH erases with the active background, so the blue runs stay blue. */
+    Screen screen;
+    screen_init(&screen, 60, 4);
+    screen_feed(&screen, out->data, out->length);
+    TEST_ASSERT_EQUAL(0, screen.unknown_codes);
+    TEST_ASSERT_EQUAL(-1, screen_mismatch(&screen, want));
+    free(screen.cells);
+    matrix_free(want);
+    tui_shutdown();
+  }
+}
+
+/* Set the environment variable `name` to `value`, or remove it if `value` is
+ * NULL. */
+static void set_env(const char *name, const char *value) {
+  if (value != NULL) {
+    setenv(name, value, 1);
+  } else {
+    unsetenv(name);
+  }
+}
+
+void test_term_caps(void) {
+  char *xterm_version = getenv("XTERM_VERSION");
+  char *tui_rep = getenv("TUI_REP");
+  xterm_version = xterm_version != NULL ? strdup(xterm_version) : NULL;
+  tui_rep = tui_rep != NULL ? strdup(tui_rep) : NULL;
+  unsetenv("XTERM_VERSION");
+  unsetenv("TUI_REP");
+
+  /* Many terminals claim to be xterm without repeating characters. */
+  TEST_ASSERT_EQUAL(TERM_CAP_ECH | TERM_CAP_DCH, term_caps("xterm-256color"));
+  TEST_ASSERT_EQUAL(TERM_CAP_REP | TERM_CAP_ECH | TERM_CAP_DCH,
+                    term_caps("foot"));
+  TEST_ASSERT_EQUAL(0, term_caps("dumb"));
+  TEST_ASSERT_EQUAL(0, term_caps(NULL));
+
+  /* Only the real xterm sets `XTERM_VERSION`. */
+  setenv("XTERM_VERSION", "XTerm(390)", 1);
+  TEST_ASSERT_EQUAL(TERM_CAP_REP | TERM_CAP_ECH | TERM_CAP_DCH,
+                    term_caps("xterm-256color"));
+
+  /* `TUI_REP` overrides the terminal. */
+  setenv("TUI_REP", "0", 1);
+  TEST_ASSERT_EQUAL(TERM_CAP_ECH | TERM_CAP_DCH, term_caps("xterm-256color"));
+  TEST_ASSERT_EQUAL(TERM_CAP_ECH | TERM_CAP_DCH, term_caps("foot"));
+  setenv("TUI_REP", "1", 1);
+  TEST_ASSERT_EQUAL(TERM_CAP_REP, term_caps("dumb"));
+
+  set_env("XTERM_VERSION", xterm_version);
+  set_env("TUI_REP", tui_rep);
+  free(xterm_version);
+  free(tui_rep);
+}
+
+void test_shift_rows_with_dch(void) {
+  replay_updates(TERM_CAP_DCH);
+  replay_updates(TERM_CAP_REP | TERM_CAP_ECH | TERM_CAP_DCH);
+
+  tui_init((TuiConfig){
+      .sink = TUI_SINK_MEMORY, .size = {80, 24}, .caps = TERM_CAP_DCH});
+  Cell blank = {.content = ' ', .text_color = FG_WHITE,
+                .background_color = BG_BLACK};
+  Cell hash = {.content = '#', .text_color = FG_WHITE,
+               .background_color = BG_WHITE};
+  Matrix *want = matrix_new(80, 24, &blank);
+  Screen screen;
+  screen_init(&screen, 80, 24);
+  size_t replayed = 0;
+  /* Every row has a few objects which move one column to the left in each
+   * frame, like asteroids, so shifting the rows is shorter than printing
+   * them again. */
+  for (int frame = 0; frame < 3; frame++) {
+    tui_clear();
+    matrix_clear_with(want, &blank);
+    for (size_t y = 0; y < 24; y++) {
+      for (size_t x = 10 + y % 7; x < 80; x += 9) {
+        tui_set_str_at(x - frame, y, "#", FG_WHITE, BG_WHITE);
+        *matrix_cell_at(want, x - frame, y) = hash;
+      }
+    }
+    tui_present();
+
+    Buffer *out = tui_memory();
+    if (frame > 0) {
+      TEST_ASSERT_TRUE(count_codes(out->data + replayed,
+                                   out->length - replayed, 'P') > 0);
+    }
+    screen_feed(&screen, out->data + replayed, out->length - replayed);
+    replayed = out->length;
+    TEST_ASSERT_EQUAL(0, screen.unknown_codes);
+    TEST_ASSERT_EQUAL(-1, screen_mismatch(&screen, want));
+  }
+  free(screen.cells);
+  matrix_free(want);
+  tui_shutdown();
+}
+
+/* Parse `answer` with `parse_query_reply`, the keys are stored in `keys`. */
+static QueryReply parse(const char *answer, char *keys) {
+  QueryReply r = parse_query_reply(answer, strlen(answer), keys);
+  keys[r.key_count] = 0;
+  return r;
+}
+
+void test_parse_query_reply(void) {
+  char keys[64];
+  QueryReply r = parse("\e[?2026;2$y\e[?62;22c", keys);
+  TEST_ASSERT(r.sync_output && r.complete);
+  TEST_ASSERT_EQUAL_STRING("", keys);
+
+  /* Keys pressed during the queries are kept, a mode which can not be set
+   * does not count. */
+  r = parse("w\e[?2026;0$y d\e[?1;2cs", keys);
+  TEST_ASSERT(!r.sync_output && r.complete);
+  TEST_ASSERT_EQUAL_STRING("w ds", keys);
+
+  /* Terminals which do not know the mode only send the attributes. */
+  r = parse("\e[?64;1c", keys);
+  TEST_ASSERT(!r.sync_output && r.complete);
+
+  /* Other modes, and replies which are not complete yet. */
+  r = parse("\e[?2027;1$yq\e[?2026;1$y\e[?6", keys);
+  TEST_ASSERT(r.sync_output && !r.complete);
+  TEST_ASSERT_EQUAL_STRING("q\e[?6", keys);
+}
+
+void test_record_video(void) {
+  const char* path = "game_test.y4m";
+  tui_init((TuiConfig){.sink = TUI_SINK_VIDEO,
+                       .size = {40, 20},
+                       .video_path = path,
+                       .video_fps = 25});
+  GameState gs = {.term_size = {40, 20},
+                  .field_begin = {1, 1},
+                  .field_end = {39, 17},
+                  .field_size = {38, 16}};
+  draw_frame(&gs);
+  tui_present();
+  /* Every frame of the video is complete, even if nothing has changed. */
+  tui_present();
+  tui_shutdown();
+
+  FILE* f = fopen(path, "rb");
+  TEST_ASSERT_NOT_NULL(f);
+  char header[64];
+  TEST_ASSERT_NOT_NULL(fgets(header, sizeof(header), f));
+  TEST_ASSERT_EQUAL_STRING("YUV4MPEG2 W320 H320 F25:1 Ip A1:1 C444\n", header);
+  fseek(f, 0, SEEK_END);
+  long frame_size = strlen("FRAME\n") + 320 * 320 * 3;
+  TEST_ASSERT_EQUAL(strlen(header) + 2 * frame_size, ftell(f));
+  fclose(f);
+  remove(path);
+}
+
+/* Replace stdin with the read end of a pipe, whose write end is stored in
+ * `fds[1]`, and start the input thread on it. The old stdin is stored in
+ * `*saved_stdin`. */
+static void start_input_from_pipe(int fds[2], int *saved_stdin) {
+  TEST_ASSERT_EQUAL(0, pipe(fds));
+  *saved_stdin = dup(STDIN_FILENO);
+  dup2(fds[0], STDIN_FILENO);
+  input_start();
+}
+
+static void stop_input_from_pipe(int fds[2], int saved_stdin) {
+  input_stop();
+  dup2(saved_stdin, STDIN_FILENO);
+  close(saved_stdin);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+/* How long the tests wait for the input thread at most. It normally takes
+ * far less, this only keeps a broken input thread from hanging the tests. */
+#define INPUT_TIMEOUT_NS 5000000000ULL
+
+/* Close the pipe and wait until the input thread noticed it. It queues all
+ * keys it read before, so afterwards the queue holds everything written to
+ * the pipe, except the keys which did not fit. */
+static void close_input_pipe(int fds[2]) {
+  close(fds[1]);
+  fds[1] = -1;
+  uint64_t deadline = clock_now() + INPUT_TIMEOUT_NS;
+  while (!input_closed() && clock_now() < deadline) {
+    sleep_until(clock_now() + 1000000);
+  }
+  TEST_ASSERT_TRUE(input_closed());
+}
+
+void test_input_bursts_do_not_lag(void) {
+  int fds[2];
+  int saved_stdin;
+  start_input_from_pipe(fds, &saved_stdin);
+  GameState gs = {.field_size = {38, 16},
+                  .ship = {.pos = {10, 8}},
+                  .projectiles = vec_new()};
+
+  /* Each burst has more keys than the input thread reads at once, and they
+   * leave the ship where it was. All of them arrive in order, and no key is
+   * left for the next burst. */
+  char burst[148];
+  for (size_t i = 0; i < sizeof(burst); i++) {
+    burst[i] = "daws"[i % 4];
+  }
+  for (int step = 0; step < 10; step++) {
+    TEST_ASSERT_EQUAL(sizeof(burst), write(fds[1], burst, sizeof(burst)));
+    uint64_t deadline = clock_now() + INPUT_TIMEOUT_NS;
+    KeyEvent e;
+    size_t count = 0;
+    while (count < sizeof(burst) && clock_now() < deadline) {
+      if (!input_next(&e, clock_now())) {
+        sleep_until(clock_now() + 1000000);
+        continue;
+      }
+      TEST_ASSERT_EQUAL(burst[count], e.key);
+      TEST_ASSERT_FALSE(handle_input(&gs, e.key));
+      count++;
+    }
+    TEST_ASSERT_EQUAL(sizeof(burst), count);
+    TEST_ASSERT_FALSE(input_next(&e, clock_now()));
+    TEST_ASSERT_EQUAL(10, gs.ship.pos.x);
+    TEST_ASSERT_EQUAL(8, gs.ship.pos.y);
+  }
+
+  stop_input_from_pipe(fds, saved_stdin);
+  vec_free(gs.projectiles);
+}
+
+void test_input_queue(void) {
+  int fds[2];
+  int saved_stdin;
+  KeyEvent e;
+
+  /* Keys which arrived after the given time are kept for later, and keys
+   * which arrived before stdin was closed are still returned. */
+  start_input_from_pipe(fds, &saved_stdin);
+  uint64_t before = clock_now();
+  TEST_ASSERT_FALSE(input_closed());
+  TEST_ASSERT_EQUAL(1, write(fds[1], "w", 1));
+  close_input_pipe(fds);
+  TEST_ASSERT_FALSE(input_next(&e, before));
+  TEST_ASSERT(input_next(&e, clock_now()));
+  TEST_ASSERT_EQUAL('w', e.key);
+  TEST_ASSERT(e.time > before);
+  TEST_ASSERT_FALSE(input_next(&e, clock_now()));
+  stop_input_from_pipe(fds, saved_stdin);
+
+  /* If nobody takes the keys, those which do not fit are dropped. */
+  start_input_from_pipe(fds, &saved_stdin);
+  char keys[300];
+  for (size_t i = 0; i < sizeof(keys); i++) {
+    keys[i] = 'a' + i % 26;
+  }
+  TEST_ASSERT_EQUAL(sizeof(keys), write(fds[1], keys, sizeof(keys)));
+  close_input_pipe(fds);
+  size_t count = 0;
+  while (input_next(&e, clock_now())) {
+    TEST_ASSERT_EQUAL(keys[count], e.key);
+    count++;
+  }
+  TEST_ASSERT_EQUAL(256, count);
+  stop_input_from_pipe(fds, saved_stdin);
+}
+
+/* Play `steps` time steps of a game with `seed`, pressing `keys` in turn. */
+static void play(GameState *gs, uint64_t seed, const char *keys, int steps) {
+  game_init(gs, (Size2){80, 24}, seed);
+  for (int t = 0; t < steps; t++) {
+    handle_input(gs, keys[t % strlen(keys)]);
+    game_update(gs);
+    game_next_step(gs);
+  }
+}
+
+void test_same_seed_same_game(void) {
+  GameState a;
+  GameState b;
+  play(&a, 42, "wd s ", 2000);
+  play(&b, 42, "wd s ", 2000);
+  TEST_ASSERT_EQUAL(a.points, b.points);
+  TEST_ASSERT_EQUAL(a.ship.health, b.ship.health);
+  TEST_ASSERT_EQUAL(vec_length(a.asteroids), vec_length(b.asteroids));
+  for (size_t i = 0; i < vec_length(a.asteroids); i++) {
+    Int2 pa = asteroid_pos(&a, *vec_at(a.asteroids, i));
+    Int2 pb = asteroid_pos(&b, *vec_at(b.asteroids, i));
+    TEST_ASSERT_EQUAL(pa.x, pb.x);
+    TEST_ASSERT_EQUAL(pa.y, pb.y);
+  }
+  game_free(&b);
+
+  /* Another seed spawns the asteroids elsewhere. */
+  play(&b, 43, "wd s ", 2000);
+  bool same = vec_length(a.asteroids) == vec_length(b.asteroids);
+  for (size_t i = 0; same && i < vec_length(a.asteroids); i++) {
+    Int2 pa = asteroid_pos(&a, *vec_at(a.asteroids, i));
+    Int2 pb = asteroid_pos(&b, *vec_at(b.asteroids, i));
+    same = pa.x == pb.x && pa.y == pb.y;
+  }
+  TEST_ASSERT_FALSE(same);
+  game_free(&a);
+  game_free(&b);
+}
+
+void test_asteroids_move_by_fractions_of_cells(void) {
+  GameState gs;
+  game_init(&gs, (Size2){80, 24}, 1);
+  Asteroid *slow = calloc(1, sizeof(Asteroid));
+  Asteroid *fast = calloc(1, sizeof(Asteroid));
+  *slow = (Asteroid){.spawn = {.origin = {50, 3}}, .speed = 0};
+  *fast = (Asteroid){.spawn = {.origin = {50, 5}}, .speed = FIX_ONE / 4};
+  vec_push(gs.asteroids, slow);
+  vec_push(gs.asteroids, fast);
+
+  /* A quarter cell per time step, and half a cell for the fast asteroid. */
+  for (int t = 0; t < 8; t++) {
+    move_drifting_objects(&gs);
+  }
+  TEST_ASSERT_EQUAL(48, asteroid_pos(&gs, slow).x);
+  TEST_ASSERT_EQUAL(46, asteroid_pos(&gs, fast).x);
+
+  /* After a mine, asteroids fly a whole cell per time step. */
+  gs.asteroid_speed = FIX_ONE;
+  move_drifting_objects(&gs);
+  TEST_ASSERT_EQUAL(47, asteroid_pos(&gs, slow).x);
+  TEST_ASSERT_EQUAL(44, asteroid_pos(&gs, fast).x);
+  TEST_ASSERT_EQUAL(3, asteroid_pos(&gs, slow).y);
+
+  /* Asteroids which left the field are removed with the next collision
+   * check, those still inside are kept. */
+  gs.asteroid_speed = 9 * FIX_ONE;
+  for (int t = 0; t < 5; t++) {
+    move_drifting_objects(&gs);
+  }
+  TEST_ASSERT_EQUAL(2, asteroid_pos(&gs, slow).x);
+  handle_asteroid_ship_collisions(&gs);
+  TEST_ASSERT_EQUAL(1, vec_length(gs.asteroids));
+  TEST_ASSERT(*vec_at(gs.asteroids, 0) == slow);
+  TEST_ASSERT_EQUAL(3, gs.ship.health);
+  move_drifting_objects(&gs);
+  handle_asteroid_ship_collisions(&gs);
+  TEST_ASSERT_EQUAL(0, vec_length(gs.asteroids));
+  game_free(&gs);
+}
+
+void test_frame_pacer_renders_while_overloaded(void) {
+  FramePacer p;
+  frame_pacer_init(&p, 60, 100);
+  TEST_ASSERT_TRUE(frame_pacer_step(&p, false));
+  int rendered = 1;
+  for (int t = 1; t < 100; t++) {
+    rendered += frame_pacer_step(&p, false);
+  }
+  TEST_ASSERT_EQUAL(60, rendered);
+  TEST_ASSERT_EQUAL(0, p.skipped);
+
+  /* If the game never catches up, every due frame would be skipped. Instead,
+   * one of `MAX_SKIPPED_FRAMES + 1` due frames is still rendered. */
+  rendered = 0;
+  int longest_gap = 0;
+  int gap = 0;
+  for (int t = 0; t < 1000; t++) {
+    if (frame_pacer_step(&p, true)) {
+      rendered++;
+      gap = 0;
+    } else {
+      gap++;
+      longest_gap = gap > longest_gap ? gap : longest_gap;
+    }
+  }
+  TEST_ASSERT_EQUAL(600 / (MAX_SKIPPED_FRAMES + 1), rendered);
+  TEST_ASSERT_EQUAL(600 - rendered, p.skipped);
+  /* Due frames are at most two time steps apart at 60 fps. */
+  TEST_ASSERT_TRUE(longest_gap <= 2 * (MAX_SKIPPED_FRAMES + 1));
+
+  /* Once the game has caught up, the next due frame is rendered. */
+  frame_pacer_init(&p, 100, 100);
+  for (int t = 0; t < MAX_SKIPPED_FRAMES - 1; t++) {
+    TEST_ASSERT_FALSE(frame_pacer_step(&p, true));
+  }
+  TEST_ASSERT_TRUE(frame_pacer_step(&p, false));
+  TEST_ASSERT_FALSE(frame_pacer_step(&p, true));
+}
+
 void tearDown(void) {}
 
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(test_collision_with_ship);
+  RUN_TEST(test_diff_kernels_agree);
+  RUN_TEST(test_render_into_memory_sink);
+  RUN_TEST(test_redraw_cells_in_place);
+  RUN_TEST(test_hud_draws_only_changes);
+  RUN_TEST(test_cursor_moves);
+  RUN_TEST(test_replay_updates);
+  RUN_TEST(test_runs_with_rep_and_ech);
+  RUN_TEST(test_term_caps);
+  RUN_TEST(test_shift_rows_with_dch);
+  RUN_TEST(test_parse_query_reply);
+  RUN_TEST(test_record_video);
+  RUN_TEST(test_input_bursts_do_not_lag);
+  RUN_TEST(test_input_queue);
+  RUN_TEST(test_same_seed_same_game);
+  RUN_TEST(test_asteroids_move_by_fractions_of_cells);
+  RUN_TEST(test_frame_pacer_renders_while_overloaded);
   return UNITY_END();
 }
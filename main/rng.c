@@ -0,0 +1,68 @@
+#include <math.h>
+
+#include "./rng.h"
+
+/* The generator which is recommended to expand a seed into the state of
+ * xoshiro256**. */
+static uint64_t splitmix64(uint64_t *x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+void rng_seed(Rng *r, uint64_t seed) {
+  for (int i = 0; i < 4; i++) {
+    r->s[i] = splitmix64(&seed);
+  }
+}
+
+static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+uint64_t rng_next(Rng *r) {
+  uint64_t *s = r->s;
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
+uint32_t rng_below(Rng *r, uint32_t bound) {
+  /* Lemire's method: the upper half of a 32 x 32 bit product is in range.
+   * Products whose lower half is below `threshold` would make some numbers
+   * more likely than others, so they are drawn again. This is rare. */
+  uint64_t m = (rng_next(r) >> 32) * bound;
+  if ((uint32_t)m < bound) {
+    uint32_t threshold = -bound % bound;
+    while ((uint32_t)m < threshold) {
+      m = (rng_next(r) >> 32) * bound;
+    }
+  }
+  return m >> 32;
+}
+
+/* A 32 bit random number is below this threshold with a probability of
+ * 1 / `one_in`, up to an error below 2^-32. */
+static uint64_t chance_threshold(uint32_t one_in) {
+  return ((uint64_t)1 << 32) / one_in;
+}
+
+bool rng_chance(Rng *r, uint32_t one_in) {
+  return (rng_next(r) >> 32) < chance_threshold(one_in);
+}
+
+uint64_t rng_skip(Rng *r, uint32_t one_in) {
+  if (one_in <= 1) {
+    return 0;
+  }
+  /* The number of failures is geometrically distributed: inverting its
+   * distribution function at a uniform `u` in (0, 1] gives
+   * floor(log(u) / log(1 - p)) for a success probability `p`. */
+  double u = ((rng_next(r) >> 11) + 1) * 0x1.0p-53;
+  return floor(log(u) / log1p(-1.0 / one_in));
+}
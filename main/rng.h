@@ -0,0 +1,41 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A pseudo random number generator (xoshiro256**).
+ *
+ * Unlike `rand()`, its state is stored in the struct, so every game has its
+ * own generator, and the same seed always produces the same numbers. This
+ * makes games reproducible and lets several games run in parallel.
+ */
+typedef struct Rng {
+  uint64_t s[4];
+} Rng;
+
+/* Initialize `r` to produce the numbers which belong to `seed`. */
+void rng_seed(Rng *r, uint64_t seed);
+
+/* Returns the next 64 random bits. */
+uint64_t rng_next(Rng *r);
+
+/* Returns a random number between 0 and `bound - 1`, where every number is
+ * equally likely. `bound` must not be 0.
+ */
+uint32_t rng_below(Rng *r, uint32_t bound);
+
+/* Returns true with a probability of 1 / `one_in`. `one_in` must not be 0. */
+bool rng_chance(Rng *r, uint32_t one_in);
+
+/* Returns how many of a series of `rng_chance(r, one_in)` trials would fail
+ * before the first one succeeds, with a single random number.
+ *
+ * Loops which decide for each of many items whether something happens, e.g.
+ * for each row whether something spawns in it, can jump from one success to
+ * the next, so they take time in proportion to the successes.
+ */
+uint64_t rng_skip(Rng *r, uint32_t one_in);
+
+#endif /* RNG_H */
@@ -78,6 +78,19 @@ void vec_remove(Vec *xs, size_t i) {
   }
 }
 
+void vec_retain(Vec *xs, bool (*keep)(void *x, void *context), void *context) {
+  size_t kept = 0;
+  for (size_t i = 0; i < xs->length; ++i) {
+    if (keep(xs->data[i], context)) {
+      xs->data[kept] = xs->data[i];
+      kept++;
+    } else {
+      free(xs->data[i]);
+    }
+  }
+  xs->length = kept;
+}
+
 void vec_print(Vec *xs) {
   printf("Vector at address %p has %ld elements and capacity %ld.\n", xs,
          vec_length(xs), vec_capacity(xs));
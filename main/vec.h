@@ -56,6 +56,14 @@ void vec_pop(Vec *xs);
 /* Like vec_pop, but removes the element at a specific index. */
 void vec_remove(Vec *xs, size_t i);
 
+/* Remove and free all elements `x` of `xs` for which `keep(x, context)` returns
+ * `false`. The remaining elements keep their order.
+ *
+ * Unlike calling `vec_remove` for each element, the elements are only moved
+ * once, so this takes linear time no matter how many elements are removed.
+ */
+void vec_retain(Vec *xs, bool (*keep)(void *x, void *context), void *context);
+
 /* Print the address, length, capacity, and elements of `xs`. */
 void vec_print(Vec *xs);
 
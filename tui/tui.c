@@ -1,5 +1,10 @@
+#include <signal.h>
+#include <stdlib.h>
+
 #include "./tui.h"
 #include "./ansi_codes.h"
+#include "./tui_layer.h"
+#include "./tui_output.h"
 
 /* The following global variables are declared to be `static`. This makes the
  * variables local to this `.c`-file, such that it is still ok to use
@@ -7,11 +12,37 @@
  * This is all that `static` does, so you can basically ignore that it's there.
  */
 
-/* How the terminal currently looks like. */
-static Matrix* old = NULL;
+/* The size of the terminal, i.e. of all layers and frames. */
+static Size2 size;
+
+/* Where frames are printed to. */
+static TuiSink sink;
+
+/* The `TermCaps` of the sink. */
+static unsigned caps;
+
+/* Set by the SIGWINCH handler when the terminal was resized, so the size is
+ * only queried again when it may have changed.
+ */
+static volatile sig_atomic_t size_changed = 0;
+
+/* How SIGWINCH was handled before `tui_init`. */
+static struct sigaction old_winch_action;
+
+static void handle_winch(int signal) {
+  (void)signal;
+  size_changed = 1;
+}
 
-/* How the terminal should look like after the next update. */
-static Matrix* new = NULL;
+/* The recording of `TUI_SINK_VIDEO`, otherwise NULL. */
+static Video* video = NULL;
+
+/* The layers from bottom to top, and the cells which have to be composed
+ * and compared with the terminal during the next update, besides the cells
+ * which the layers report with `layer_take_drawn`.
+ */
+TuiCanvas tui_canvas;
+static Layer** const layers = tui_canvas.layers;
 
 /* Cell used to initialize new terminal cells, e.g. at the beginning or after
  * the terminal was resized.
@@ -19,38 +50,67 @@ static Matrix* new = NULL;
 static Cell def_cell = (Cell){
     .content = ' ', .text_color = FG_WHITE, .background_color = BG_BLACK};
 
-/* Cell which is different from all regular cells.
- *
- * If `old` contains a `null_cell`, then the next call to `tui_update` will
- * definitely redraw the cell from `new` at the same position.
- */
-static Cell null_cell =
-    (Cell){.content = 0, .text_color = "", .background_color = ""};
+void tui_init(TuiConfig config) {
+  sink = config.sink;
+  size = config.size;
+  caps = config.caps;
+  if (sink == TUI_SINK_TERMINAL) {
+    set_raw_terminal_mode();
 
-void tui_init(void) {
-  set_raw_terminal_mode();
+    printf("%s", CURSOR_HIDE);
+    printf("%s", CLEAR_SCREEN);
 
-  printf("%s", CURSOR_HIDE);
-  printf("%s", CLEAR_SCREEN);
+    size = query_size();
+    caps = query_caps();
 
-  Size2 size = query_size();
-  new = matrix_new(size.x, size.y, &def_cell);
-  old = matrix_new(size.x, size.y, &null_cell);
+    struct sigaction winch_action = {.sa_handler = handle_winch,
+                                     .sa_flags = SA_RESTART};
+    sigemptyset(&winch_action.sa_mask);
+    size_changed = 0;
+    sigaction(SIGWINCH, &winch_action, &old_winch_action);
+  }
+  if (sink == TUI_SINK_VIDEO) {
+    video = video_open(config.video_path, size.x, size.y, config.video_fps);
+    if (video == NULL) {
+      printf("ERROR: could not open %s for recording.\n", config.video_path);
+      exit(1);
+    }
+  }
+  for (size_t l = 0; l < TUI_LAYER_COUNT; ++l) {
+    layers[l] = layer_new(size.x, size.y);
+  }
+  tui_canvas.damage = damage_new(size.x, size.y);
+  damage_add_all(tui_canvas.damage);
+  output_reset();
+  output_start(size.x, size.y, sink, caps, video);
 }
 
 void tui_shutdown(void) {
-  matrix_free(new);
-  matrix_free(old);
+  output_stop();
+  /* The statistics stay readable until the next `tui_init`. */
+  buffer_free(output_memory());
+  if (video != NULL) {
+    video_close(video);
+    video = NULL;
+  }
+  for (size_t l = 0; l < TUI_LAYER_COUNT; ++l) {
+    layer_free(layers[l]);
+  }
+  damage_free(tui_canvas.damage);
+
+  if (sink == TUI_SINK_TERMINAL) {
+    sigaction(SIGWINCH, &old_winch_action, NULL);
 
-  printf("%s", COLOR_RESET);
-  printf("%s", CURSOR_SHOW);
-  printf("%s", CLEAR_SCREEN);
-  move_cursor_to(0, 0);
+    printf("%s", COLOR_RESET);
+    printf("%s", CURSOR_SHOW);
+    printf("%s", CLEAR_SCREEN);
+    move_cursor_to(0, 0);
 
-  fflush(stdout);
+    fflush(stdout);
+  }
 }
 
-Cell* tui_cell_at(size_t x, size_t y) {
+void tui_check_cell(size_t x, size_t y) {
   /* Same as `assert` but prints a stack trace if
    * used with the address sanitizer.
    *
@@ -62,41 +122,133 @@ Cell* tui_cell_at(size_t x, size_t y) {
    * simply cause a segmentation fault by writing to the NULL-Pointer, which the
    * address sanitizer then detects and spits out a stack trace for us :3
    */
-  size_t width = matrix_width(new);
-  size_t height = matrix_height(new);
+  size_t width = size.x;
+  size_t height = size.y;
   if (x >= width || y >= height) {
     tui_shutdown();
-    printf(FG_RED "ASSERTION FAILED: (%lu, %lu) is too large for `tui_cell_at`, which has a matrix of size %lu x %lu.\n\n" COLOR_RESET, x, y, width, height);
+    printf(FG_RED "ASSERTION FAILED: (%lu, %lu) is too large for `tui_layer_cell_at`, which has a matrix of size %lu x %lu.\n\n" COLOR_RESET, x, y, width, height);
     fflush(stdout);
     int* null = NULL;
     *null = 42;
   }
-  return matrix_cell_at(new, x, y);
+}
+
+void tui_layer_set_str_at(TuiLayer layer, size_t x, size_t y, const char* s,
+                          const char* text_color,
+                          const char* background_color) {
+  while (x < size.x && *s != 0) {
+    *tui_layer_cell_at(layer, x, y) = (Cell){.content = *s,
+                                             .text_color = text_color,
+                                             .background_color =
+                                                 background_color};
+    ++x;
+    ++s;
+  }
+}
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+
+void tui_layer_blit(TuiLayer layer, const Sprite* s, int x, int y,
+                    Size2 clip_begin, Size2 clip_end) {
+  /* The part of the rectangle which is inside the terminal. */
+  int begin_x = clip_begin.x;
+  int begin_y = clip_begin.y;
+  int end_x = MIN(clip_end.x, size.x);
+  int end_y = MIN(clip_end.y, size.y);
+  for (size_t i = 0; i < s->run_count; ++i) {
+    const SpriteRun* run = &s->runs[i];
+    int run_y = y + run->y;
+    int run_begin = MAX(x + run->x, begin_x);
+    int run_end = MIN(x + run->x + (int)run->length, end_x);
+    if (run_y < begin_y || run_y >= end_y || run_begin >= run_end) {
+      continue;
+    }
+    layer_set_cells(layers[layer], run_begin, run_y,
+                    run->cells + (run_begin - (x + run->x)),
+                    run_end - run_begin, tui_canvas.damage);
+  }
+}
+
+void tui_layer_clear(TuiLayer layer) {
+  layer_clear(layers[layer], tui_canvas.damage);
 }
 
 void tui_set_str_at(size_t x, size_t y, const char* s, const char* text_color,
                     const char* background_color) {
-  matrix_set_str_at(new, x, y, s, text_color, background_color);
+  tui_layer_set_str_at(TUI_LAYER_ENTITY, x, y, s, text_color,
+                       background_color);
 }
 
 Size2 tui_size(void) {
-  Size2 size = query_size();
-  if (size.x != matrix_width(new) || size.y != matrix_height(new)) {
-    matrix_free(old);
-    old = matrix_new(size.x, size.y, &null_cell);
-    matrix_resize(new, size.x, size.y, &def_cell);
+  if (sink != TUI_SINK_TERMINAL || !size_changed) {
+    return size;
+  }
+  size_changed = 0;
+  Size2 new_size = query_size();
+  if (new_size.x != size.x || new_size.y != size.y) {
+    size = new_size;
+    output_stop();
+    for (size_t l = 0; l < TUI_LAYER_COUNT; ++l) {
+      layer_resize(layers[l], size.x, size.y);
+    }
+    damage_resize(tui_canvas.damage, size.x, size.y);
+    output_start(size.x, size.y, sink, caps, video);
   }
   return size;
 }
 
-void tui_update(void) {
-  matrix_print_update(old, new);
+/* Update the cell of `f` at (x, y) to show the topmost non-transparent cell
+ * of all layers.
+ */
+static void compose_cell_at(Frame* f, size_t x, size_t y) {
+  const Cell* c = &def_cell;
+  for (size_t l = TUI_LAYER_COUNT; l-- > 0;) {
+    const Cell* lc = layer_get(layers[l], x, y);
+    if (lc->content != 0) {
+      c = lc;
+      break;
+    }
+  }
+  *matrix_cell_at(f->cells, x, y) = *c;
+}
+
+void tui_present(void) {
+  for (size_t l = 0; l < TUI_LAYER_COUNT; ++l) {
+    layer_take_drawn(layers[l], tui_canvas.damage);
+  }
+  Damage* outdated = NULL;
+  Frame* f = output_begin_frame(tui_canvas.damage, &outdated);
+  if (damage_is_full(outdated)) {
+    for (size_t y = 0; y < size.y; ++y)
+      for (size_t x = 0; x < size.x; ++x)
+        compose_cell_at(f, x, y);
+  } else {
+    Size2* positions = damage_positions(outdated);
+    for (size_t i = 0; i < damage_count(outdated); ++i) {
+      compose_cell_at(f, positions[i].x, positions[i].y);
+    }
+  }
+  output_end_frame();
+  damage_reset(tui_canvas.damage);
+}
+
+TuiStats tui_stats(void) {
+  return output_stats();
+}
+
+Buffer* tui_memory(void) {
+  return output_memory();
 }
 
 void tui_clear_with(Cell* c) {
-  matrix_clear_with(new, c);
+  def_cell = *c;
+  for (size_t l = 0; l < TUI_LAYER_COUNT; ++l) {
+    layer_clear(layers[l], tui_canvas.damage);
+  }
+  damage_add_all(tui_canvas.damage);
 }
 
 void tui_clear(void) {
-  matrix_clear(new);
+  tui_layer_clear(TUI_LAYER_ENTITY);
 }
@@ -4,21 +4,46 @@
 #include <stdio.h>
 
 #include "./tui_io.h"
+#include "./tui_layer.h"
 #include "./tui_matrix.h"
+#include "./tui_output.h"
+#include "./tui_sprite.h"
+#include "./tui_hud.h"
+#include "./tui_input.h"
 #include "./ansi_codes.h"
 
+/* How the tui should be set up by `tui_init`. */
+typedef struct TuiConfig {
+  TuiSink sink; /* Where frames are printed to. */
+  Size2 size;   /* The size of the simulated terminal if `sink` is not
+                   `TUI_SINK_TERMINAL`. The size of a real terminal is queried
+                   instead. */
+  unsigned caps; /* The `TermCaps` of the simulated terminal if `sink` is not
+                    `TUI_SINK_TERMINAL`. The capabilities of a real terminal
+                    are detected instead. */
+  const char* video_path; /* Where `TUI_SINK_VIDEO` writes to, see
+                             `video_open`. */
+  unsigned video_fps;     /* The frame rate of `TUI_SINK_VIDEO`. */
+} TuiConfig;
+
 /* Configure the terminal for interactive use.
  *
  * Specifically:
  * - sets the terminal mode to raw
  * - clears the terminal content and hides the cursor
- * - initializes the global matrices to match the current terminal size.
+ * - initializes the global matrices to match the current terminal size
+ * - starts the output thread.
+ *
+ * If `config.sink` is not `TUI_SINK_TERMINAL`, the terminal is not touched at
+ * all, so the tui also works without a terminal, e.g. in tests.
  */
-void tui_init(void);
+void tui_init(TuiConfig config);
 
 /* Reset the terminal for normal use.
  *
  * Specifically:
+ * - stops the output thread, so nothing below is written into the middle of
+ *   a frame, and makes stdout blocking again
  * - brings the terminal back to normal mode
  * - clears the terminal content, shows the cursor, resets the terminal
  *   colors, and moves the cursor to position (0,0), such that the terminal
@@ -27,28 +52,127 @@ void tui_init(void);
  */
 void tui_shutdown(void);
 
-/* Retrieve the cell of the character at position (x, y). */
-Cell* tui_cell_at(size_t x, size_t y);
+/* The terminal content is composed of layers. Cells drawn on an upper layer
+ * hide the cells of the lower layers at the same position. Cells which are not
+ * drawn on any layer are shown as the space character with black background.
+ *
+ * Layers keep their content between frames. Only cells which were drawn or
+ * cleared since the last `tui_present` are compared with the terminal, so the
+ * work per update depends on how much is drawn and not on the terminal size.
+ */
+typedef enum TuiLayer {
+  TUI_LAYER_STATIC, /* Content which is drawn once, e.g. borders. */
+  TUI_LAYER_HUD,    /* Status information, redrawn when its values change. */
+  TUI_LAYER_ENTITY, /* Moving objects, cleared and redrawn every frame. */
+  TUI_LAYER_COUNT,
+} TuiLayer;
+
+/* The cell accessors below only check their coordinates in debug builds and
+ * in builds with the address sanitizer. Release builds (`-DNDEBUG`) rely on
+ * the callers to clip their coordinates once, e.g. per sprite or per object,
+ * so the drawing loops contain no further branches.
+ */
+#if !defined(NDEBUG) || defined(__SANITIZE_ADDRESS__)
+#define TUI_CHECKS 1
+#endif
+
+/* The layers and the cells which changed since the last `tui_present`.
+ *
+ * Only public, so the cell accessors below can be inlined into the drawing
+ * loops, like `matrix_cell_at`. Do not use the members directly.
+ */
+typedef struct TuiCanvas {
+  Layer* layers[TUI_LAYER_COUNT];
+  Damage* damage;
+} TuiCanvas;
+
+extern TuiCanvas tui_canvas;
+
+/* Stop the program with a stack trace if (x, y) is outside of the terminal.
+ * Only called by the accessors below if `TUI_CHECKS` is defined. */
+void tui_check_cell(size_t x, size_t y);
+
+/* Retrieve the cell of the character at position (x, y) on `layer` for
+ * drawing.
+ */
+static inline Cell* tui_layer_cell_at(TuiLayer layer, size_t x, size_t y) {
+#ifdef TUI_CHECKS
+  tui_check_cell(x, y);
+#endif
+  return layer_cell_at(tui_canvas.layers[layer], x, y, tui_canvas.damage);
+}
+
+/* Like `tui_set_str_at`, but draws on `layer`. */
+void tui_layer_set_str_at(TuiLayer layer, size_t x, size_t y, const char* s,
+                          const char* text_color,
+                          const char* background_color);
+
+/* Draw sprite `s` on `layer` with its origin at (x, y). Only the cells inside
+ * the rectangle from `clip_begin` to one before `clip_end` are drawn, e.g. the
+ * cells inside the game field, so a sprite may be partially or completely
+ * outside of the rectangle.
+ *
+ * The sprite is clipped once, afterwards its runs of cells are copied without
+ * further checks.
+ */
+void tui_layer_blit(TuiLayer layer, const Sprite* s, int x, int y,
+                    Size2 clip_begin, Size2 clip_end);
+
+/* Make all cells of `layer`, which were drawn since the layer was cleared the
+ * last time, transparent again.
+ */
+void tui_layer_clear(TuiLayer layer);
+
+/* Retrieve the cell of the character at position (x, y) on the entity layer.
+ */
+static inline Cell* tui_cell_at(size_t x, size_t y) {
+  return tui_layer_cell_at(TUI_LAYER_ENTITY, x, y);
+}
 
 /* Render string `s` with styles `text_color` and `background_color` starting
- * from position `(x, y)`. If the matrix row is not long enough to hold the
- * string, only parts of the string are shown.
+ * from position `(x, y)` on the entity layer. If the matrix row is not long
+ * enough to hold the string, only parts of the string are shown.
  *
  * The string `s` is not allowed to contain any line breaks \n.
  */
 void tui_set_str_at(size_t x, size_t y, const char* s, const char* text_color,
                     const char* background_color);
 
-/* Query the current terminal size and resize the matrices if necessary. */
+/* Returns the current terminal size.
+ *
+ * The size is only queried again after the terminal has signaled a resize
+ * with SIGWINCH, so this is cheap enough to be called every time step. If the
+ * size has changed, the layers are resized, keeping the cells which are still
+ * inside, and the next frame redraws every cell of the terminal.
+ */
 Size2 tui_size(void);
 
-/* Print changes done with `tui_cell_at` and `tui_set_str_at` to the terminal. */
-void tui_update(void);
+/* Hand the changes done since the last call to the output thread, which
+ * prints them to the terminal.
+ *
+ * The output thread always prints the most recent frame. If the terminal is
+ * too slow to keep up, older frames are dropped instead of slowing down the
+ * caller. Frames are passed between the threads in a fixed set of buffers, so
+ * no frame is ever copied; only the cells of a buffer which are outdated are
+ * composed again.
+ */
+void tui_present(void);
+
+/* Returns statistics about the frames printed since `tui_init`. They can
+ * still be read after `tui_shutdown`, until the next `tui_init`. */
+TuiStats tui_stats(void);
 
-/* Set all cells to be equal to `c`. */
+/* Returns everything printed to the sink `TUI_SINK_MEMORY` since `tui_init`.
+ * The buffer is freed by `tui_shutdown`. */
+Buffer* tui_memory(void);
+
+/* Clear all layers and show `c` in every cell which is not drawn on any layer.
+ */
 void tui_clear_with(Cell* c);
 
-/* Set all cells be the space character with black background and white text color. */
+/* Clear the entity layer. Only the cells drawn since the last clear are
+ * touched.
+ */
 void tui_clear(void);
 
 #endif /* TUI_H */
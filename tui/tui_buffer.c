@@ -0,0 +1,50 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "./tui_buffer.h"
+
+void buffer_init(Buffer* b) {
+  *b = (Buffer){.data = NULL, .length = 0, .capacity = 0};
+}
+
+void buffer_free(Buffer* b) {
+  free(b->data);
+  buffer_init(b);
+}
+
+void buffer_clear(Buffer* b) {
+  b->length = 0;
+}
+
+/* Make sure that `n` more bytes fit into `b`. Exits the program if we run out
+ * of memory.
+ */
+static void buffer_reserve(Buffer* b, size_t n) {
+  if (b->length + n <= b->capacity) {
+    return;
+  }
+  size_t capacity = b->capacity == 0 ? 4096 : b->capacity;
+  while (capacity < b->length + n) {
+    capacity *= 2;
+  }
+  b->data = realloc(b->data, capacity);
+  if (b->data == NULL) {
+    exit(1);
+  }
+  b->capacity = capacity;
+}
+
+void buffer_append(Buffer* b, const char* s, size_t n) {
+  buffer_reserve(b, n);
+  memcpy(b->data + b->length, s, n);
+  b->length += n;
+}
+
+void buffer_append_str(Buffer* b, const char* s) {
+  buffer_append(b, s, strlen(s));
+}
+
+void buffer_append_char(Buffer* b, char c) {
+  buffer_reserve(b, 1);
+  b->data[b->length++] = c;
+}
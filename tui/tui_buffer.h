@@ -0,0 +1,33 @@
+#ifndef TUI_BUFFER_H
+#define TUI_BUFFER_H
+
+#include <stddef.h>
+
+/* A growable array of bytes, e.g. the text and ANSI codes of a frame, which
+ * are collected first and then written to the terminal at once.
+ */
+typedef struct Buffer {
+  char* data;      /* The bytes, not terminated by 0. */
+  size_t length;   /* How many bytes are currently stored in `data`. */
+  size_t capacity; /* How many bytes fit into `data` before it is reallocated. */
+} Buffer;
+
+/* Initialize `b` to be empty. */
+void buffer_init(Buffer* b);
+
+/* Free the dynamically allocated memory of `b`. */
+void buffer_free(Buffer* b);
+
+/* Remove all bytes, but keep the memory for the next use. */
+void buffer_clear(Buffer* b);
+
+/* Append the `n` bytes at `s`. */
+void buffer_append(Buffer* b, const char* s, size_t n);
+
+/* Append the 0-terminated string `s` without the 0. */
+void buffer_append_str(Buffer* b, const char* s);
+
+/* Append the single byte `c`. */
+void buffer_append_char(Buffer* b, char c);
+
+#endif /* TUI_BUFFER_H */
@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#include "./tui_diff.h"
+
+_Static_assert(sizeof(Cell) == 2 * sizeof(const char*) + 1 +
+                                   sizeof(((Cell*)NULL)->padding),
+               "Cell must not contain implicit padding bytes");
+
+/* Each kernel returns the offset of the first byte in which `a` and `b`
+ * differ, or `n` if the first `n` bytes are equal.
+ */
+typedef size_t (*FindDiffFn)(const unsigned char* a, const unsigned char* b,
+                             size_t n);
+
+static size_t find_diff_scalar(const unsigned char* a, const unsigned char* b,
+                               size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t wa;
+    uint64_t wb;
+    memcpy(&wa, a + i, 8);
+    memcpy(&wb, b + i, 8);
+    if (wa != wb) {
+      break;
+    }
+  }
+  for (; i < n; ++i) {
+    if (a[i] != b[i]) {
+      return i;
+    }
+  }
+  return n;
+}
+
+#ifdef HAVE_X86_SIMD
+
+__attribute__((target("sse2"))) static size_t find_diff_sse2(
+    const unsigned char* a, const unsigned char* b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+    unsigned mask = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) &
+                    0xFFFFu;
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + find_diff_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) static size_t find_diff_avx2(
+    const unsigned char* a, const unsigned char* b, size_t n) {
+  size_t i = 0;
+  /* Compare 64 bytes per iteration and only locate the exact byte once a
+   * difference was found. */
+  for (; i + 64 <= n; i += 64) {
+    __m256i eq0 =
+        _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)),
+                          _mm256_loadu_si256((const __m256i*)(b + i)));
+    __m256i eq1 =
+        _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i + 32)),
+                          _mm256_loadu_si256((const __m256i*)(b + i + 32)));
+    if ((unsigned)_mm256_movemask_epi8(_mm256_and_si256(eq0, eq1)) !=
+        0xFFFFFFFFu) {
+      unsigned mask0 = ~(unsigned)_mm256_movemask_epi8(eq0);
+      if (mask0 != 0) {
+        return i + __builtin_ctz(mask0);
+      }
+      return i + 32 + __builtin_ctz(~(unsigned)_mm256_movemask_epi8(eq1));
+    }
+  }
+  for (; i + 32 <= n; i += 32) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+    unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + find_diff_scalar(a + i, b + i, n - i);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+/* The kernel for the current CPU, selected by the first call. */
+static FindDiffFn find_diff = NULL;
+
+static FindDiffFn select_find_diff(void) {
+#ifdef HAVE_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return find_diff_avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return find_diff_sse2;
+  }
+#endif
+  return find_diff_scalar;
+}
+
+bool cells_diff_use_kernel(DiffKernel k) {
+  switch (k) {
+    case DIFF_KERNEL_SCALAR:
+      find_diff = find_diff_scalar;
+      return true;
+#ifdef HAVE_X86_SIMD
+    case DIFF_KERNEL_SSE2:
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("sse2")) {
+        find_diff = find_diff_sse2;
+        return true;
+      }
+      return false;
+    case DIFF_KERNEL_AVX2:
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2")) {
+        find_diff = find_diff_avx2;
+        return true;
+      }
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+size_t cells_find_diff(const Cell* a, const Cell* b, size_t begin,
+                       size_t end) {
+  if (begin >= end) {
+    return end;
+  }
+  if (find_diff == NULL) {
+    find_diff = select_find_diff();
+  }
+  size_t n = (end - begin) * sizeof(Cell);
+  size_t offset = find_diff((const unsigned char*)(a + begin),
+                            (const unsigned char*)(b + begin), n);
+  return begin + offset / sizeof(Cell);
+}
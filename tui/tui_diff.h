@@ -0,0 +1,34 @@
+#ifndef TUI_DIFF_H
+#define TUI_DIFF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./tui_matrix.h"
+
+/* Returns the index of the first cell in the range [begin, end) whose bytes
+ * differ between the rows `a` and `b`, or `end` if all bytes are equal.
+ *
+ * Cells with different bytes may still be equal, e.g. if their colors are
+ * equal strings at different addresses, so callers have to compare the
+ * returned cell with `cell_eq` before printing it.
+ *
+ * The comparison uses AVX2 or SSE2 instructions if the CPU supports them and
+ * falls back to comparing 8 bytes at a time otherwise.
+ */
+size_t cells_find_diff(const Cell* a, const Cell* b, size_t begin, size_t end);
+
+/* The implementations of `cells_find_diff`. */
+typedef enum DiffKernel {
+  DIFF_KERNEL_SCALAR,
+  DIFF_KERNEL_SSE2,
+  DIFF_KERNEL_AVX2,
+} DiffKernel;
+
+/* Make `cells_find_diff` use kernel `k` instead of the fastest one, e.g. to
+ * check in tests that all kernels agree. Returns false and keeps the current
+ * kernel if the CPU does not support `k`.
+ */
+bool cells_diff_use_kernel(DiffKernel k);
+
+#endif /* TUI_DIFF_H */
@@ -0,0 +1,498 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "./tui_diff.h"
+#include "./tui_encoder.h"
+
+/* Gaps of at most this many cells are considered for printing the cells in
+ * the gap again instead of moving the cursor over them.
+ */
+#define MAX_REPRINT 8
+
+/* The decimal representations of 0 to 99 with two characters each, so numbers
+ * can be formatted two digits at a time without `printf`.
+ */
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* Returns how many decimal digits `n` has. */
+static size_t digit_count(size_t n) {
+  size_t count = 1;
+  while (n >= 10) {
+    n /= 10;
+    ++count;
+  }
+  return count;
+}
+
+/* Append the decimal representation of `n` to `out`. */
+static void append_uint(Buffer* out, size_t n) {
+  char buf[20];
+  char* p = buf + sizeof(buf);
+  while (n >= 100) {
+    p -= 2;
+    memcpy(p, digit_pairs + (n % 100) * 2, 2);
+    n /= 100;
+  }
+  if (n >= 10) {
+    p -= 2;
+    memcpy(p, digit_pairs + n * 2, 2);
+  } else {
+    *--p = '0' + n;
+  }
+  buffer_append(out, p, buf + sizeof(buf) - p);
+}
+
+/* Returns the length of the ANSI code `ESC[nF`, in which the parameter `n` is
+ * left out if it is 1, because 1 is the default.
+ */
+static size_t csi_len(size_t n) {
+  return n == 1 ? 3 : 3 + digit_count(n);
+}
+
+/* Append the ANSI code `ESC[nF` with the final character `final`. */
+static void append_csi(Buffer* out, size_t n, char final) {
+  buffer_append(out, "\e[", 2);
+  if (n != 1) {
+    append_uint(out, n);
+  }
+  buffer_append_char(out, final);
+}
+
+/* Returns the length of the ANSI code which moves the cursor to column `x` and
+ * row `y`. Rows and columns of the code start at 1 and default to 1.
+ */
+static size_t cup_len(size_t x, size_t y) {
+  if (x == 0) {
+    return y == 0 ? 3 : 3 + digit_count(y + 1);
+  }
+  return 4 + digit_count(y + 1) + digit_count(x + 1);
+}
+
+/* Append the ANSI code which moves the cursor to column `x` and row `y`. */
+static void append_cup(Buffer* out, size_t x, size_t y) {
+  buffer_append(out, "\e[", 2);
+  if (y != 0 || x != 0) {
+    append_uint(out, y + 1);
+  }
+  if (x != 0) {
+    buffer_append_char(out, ';');
+    append_uint(out, x + 1);
+  }
+  buffer_append_char(out, 'H');
+}
+
+static bool str_eq(const char* s1, const char* s2) {
+  return s1 == s2 || strcmp(s1, s2) == 0;
+}
+
+/* Returns true iff the colors `text_color` and `background_color` are the
+ * colors of `c`.
+ */
+static bool colors_eq(const char* text_color, const char* background_color,
+                      const Cell* c) {
+  return text_color != NULL && str_eq(text_color, c->text_color) &&
+         str_eq(background_color, c->background_color);
+}
+
+/* Make the colors of `c` the active colors. */
+static void set_colors(Encoder* e, const Cell* c) {
+  if (!colors_eq(e->text_color, e->background_color, c)) {
+    buffer_append_str(e->out, c->text_color);
+    buffer_append_str(e->out, c->background_color);
+    e->text_color = c->text_color;
+    e->background_color = c->background_color;
+  }
+}
+
+/* Print the content of `c` at the current cursor position. */
+static void put_cell(Encoder* e, const Cell* c) {
+  set_colors(e, c);
+  buffer_append_char(e->out, c->content);
+}
+
+/* Returns how many bytes it takes to print the cells in the columns
+ * [from, to) of row `y` of `m` with the colors currently active.
+ */
+static size_t reprint_len(Encoder* e, Matrix* m, size_t y, size_t from,
+                          size_t to) {
+  const char* text_color = e->text_color;
+  const char* background_color = e->background_color;
+  size_t len = 0;
+  for (size_t x = from; x < to; ++x) {
+    Cell* c = matrix_cell_at(m, x, y);
+    if (!colors_eq(text_color, background_color, c)) {
+      len += strlen(c->text_color) + strlen(c->background_color);
+      text_color = c->text_color;
+      background_color = c->background_color;
+    }
+    len += 1;
+  }
+  return len;
+}
+
+/* Ways to move the cursor within a row. */
+typedef enum Move {
+  MOVE_NONE,     /* The cursor already is in the right column. */
+  MOVE_FORWARD,  /* Cursor forward (CUF). */
+  MOVE_BACKWARD, /* Cursor backward (CUB). */
+  MOVE_REPRINT,  /* Print the cells in between again. */
+} Move;
+
+/* Returns the length of the shortest way to move the cursor from column `from`
+ * to column `to` in row `y` and stores that way in `move`.
+ */
+static size_t horizontal_len(Encoder* e, Matrix* m, size_t y, size_t from,
+                             size_t to, Move* move) {
+  if (to == from) {
+    *move = MOVE_NONE;
+    return 0;
+  }
+  if (to < from) {
+    *move = MOVE_BACKWARD;
+    return csi_len(from - to);
+  }
+  *move = MOVE_FORWARD;
+  size_t len = csi_len(to - from);
+  if (to - from <= MAX_REPRINT) {
+    size_t reprint = reprint_len(e, m, y, from, to);
+    if (reprint < len) {
+      *move = MOVE_REPRINT;
+      len = reprint;
+    }
+  }
+  return len;
+}
+
+/* Move the cursor from column `from` to column `to` within row `y`. */
+static void move_horizontal(Encoder* e, Matrix* m, size_t y, size_t from,
+                            size_t to, Move move) {
+  switch (move) {
+    case MOVE_NONE:
+      break;
+    case MOVE_FORWARD:
+      append_csi(e->out, to - from, 'C');
+      break;
+    case MOVE_BACKWARD:
+      append_csi(e->out, from - to, 'D');
+      break;
+    case MOVE_REPRINT:
+      for (size_t x = from; x < to; ++x) {
+        put_cell(e, matrix_cell_at(m, x, y));
+      }
+      break;
+  }
+}
+
+void encoder_init(Encoder* e, Buffer* out, unsigned caps) {
+  e->out = out;
+  e->caps = caps;
+  e->shifted = NULL;
+  e->shifted_width = 0;
+  buffer_init(&e->trial);
+  buffer_init(&e->trial_shifted);
+  encoder_reset(e);
+}
+
+void encoder_free(Encoder* e) {
+  free(e->shifted);
+  buffer_free(&e->trial);
+  buffer_free(&e->trial_shifted);
+}
+
+void encoder_reset(Encoder* e) {
+  e->cursor_known = false;
+  e->x = 0;
+  e->y = 0;
+  e->text_color = NULL;
+  e->background_color = NULL;
+}
+
+void encoder_move_to(Encoder* e, Matrix* m, size_t x, size_t y) {
+  if (e->cursor_known && e->x == x && e->y == y) {
+    return;
+  }
+
+  size_t absolute = cup_len(x, y);
+  if (e->cursor_known) {
+    size_t vertical = 0;
+    if (y != e->y) {
+      vertical = csi_len(y > e->y ? y - e->y : e->y - y);
+    }
+    Move move;
+    size_t relative = vertical + horizontal_len(e, m, y, e->x, x, &move);
+    Move cr_move;
+    size_t cr = vertical + 1 + horizontal_len(e, m, y, 0, x, &cr_move);
+
+    if (relative <= absolute || cr <= absolute) {
+      if (y > e->y) {
+        append_csi(e->out, y - e->y, 'B');
+      } else if (y < e->y) {
+        append_csi(e->out, e->y - y, 'A');
+      }
+      if (relative <= cr) {
+        move_horizontal(e, m, y, e->x, x, move);
+      } else {
+        buffer_append_char(e->out, '\r');
+        move_horizontal(e, m, y, 0, x, cr_move);
+      }
+      e->x = x;
+      e->y = y;
+      return;
+    }
+  }
+
+  append_cup(e->out, x, y);
+  e->cursor_known = true;
+  e->x = x;
+  e->y = y;
+}
+
+void encoder_print_cell(Encoder* e, Matrix* m, size_t x, size_t y) {
+  encoder_move_to(e, m, x, y);
+  put_cell(e, matrix_cell_at(m, x, y));
+  e->x = x + 1;
+  /* After printing into the last column, terminals differ in where the cursor
+   * is, so we position it absolutely next time. */
+  if (e->x >= matrix_width(m)) {
+    e->cursor_known = false;
+  }
+}
+
+/* Returns the length of the run of cells of row `y` of `new` which starts at
+ * column `x` and whose cells are equal to the cell at (x, y). The run ends with
+ * a cell which differs from `row_old`, unchanged cells are not worth printing.
+ */
+static size_t run_length(Cell* row_old, Matrix* new, size_t x, size_t y) {
+  size_t width = matrix_width(new);
+  Cell* row_new = matrix_cell_at(new, 0, y);
+  size_t n = 1;
+  while (x + n < width && cell_eq(row_new + x + n, row_new + x)) {
+    ++n;
+  }
+  while (n > 1 && cell_eq(row_old + x + n - 1, row_new + x + n - 1)) {
+    --n;
+  }
+  return n;
+}
+
+/* Print the run of `n` equal cells of `m` starting at (x, y) with a single
+ * code, if that is shorter than printing the cells. Otherwise only the first
+ * cell is printed.
+ *
+ * Returns how many cells were printed.
+ */
+static size_t print_run(Encoder* e, Matrix* m, size_t x, size_t y, size_t n) {
+  Cell* c = matrix_cell_at(m, x, y);
+  bool to_end = x + n == matrix_width(m);
+  /* ECH does not move the cursor, so after a run in the middle of a row REP
+   * is better, because the cursor already is behind the run. */
+  if ((e->caps & TERM_CAP_ECH) && c->content == ' ' &&
+      (to_end || !(e->caps & TERM_CAP_REP)) && csi_len(n) < n) {
+    encoder_move_to(e, m, x, y);
+    set_colors(e, c);
+    append_csi(e->out, n, 'X');
+    return n;
+  }
+  if ((e->caps & TERM_CAP_REP) && 1 + csi_len(n - 1) < n) {
+    encoder_print_cell(e, m, x, y);
+    append_csi(e->out, n - 1, 'b');
+    e->x = x + n;
+    if (e->x >= matrix_width(m)) {
+      e->cursor_known = false;
+    }
+    return n;
+  }
+  encoder_print_cell(e, m, x, y);
+  return 1;
+}
+
+/* Returns how many of the `n` cells at `c1` and `c2` differ. */
+static size_t count_changed(Cell* c1, Cell* c2, size_t n) {
+  size_t changed = 0;
+  for (size_t i = 0; i < n; ++i) {
+    changed += !cell_eq(c1 + i, c2 + i);
+  }
+  return changed;
+}
+
+/* Print the cells of row `y` of `new` which differ from `row_old`, the row
+ * the terminal shows. Returns how many cells were printed.
+ */
+static size_t print_row_diff(Encoder* e, Cell* row_old, Matrix* new,
+                             size_t y) {
+  size_t width = matrix_width(new);
+  Cell* row_new = matrix_cell_at(new, 0, y);
+  size_t printed = 0;
+  /* Skip runs of identical cells, only cells with different bytes have to be
+   * compared in detail. */
+  size_t x = cells_find_diff(row_old, row_new, 0, width);
+  while (x < width) {
+    size_t n = 1;
+    if (!cell_eq(row_old + x, row_new + x)) {
+      /* The run may contain unchanged cells, printing them again is
+       * harmless. */
+      if (e->caps & (TERM_CAP_REP | TERM_CAP_ECH)) {
+        n = run_length(row_old, new, x, y);
+      }
+      n = print_run(e, new, x, y, n);
+      printed += count_changed(row_old + x, row_new + x, n);
+    }
+    x = cells_find_diff(row_old, row_new, x + n, width);
+  }
+  return printed;
+}
+
+/* Cell which is different from all regular cells. It stands for the blank cell
+ * inserted by ICH, whose colors depend on the terminal.
+ */
+static Cell unknown_cell =
+    (Cell){.content = 0, .text_color = "", .background_color = ""};
+
+/* Print the differences in row `y` between `old` and `new`.
+ *
+ * If most of the differences are caused by content moving one column to the
+ * left, e.g. asteroids flying towards the ship, the changed part [a, b) of the
+ * row is shifted on the terminal instead: DCH at column a deletes a cell and
+ * moves the rest of the row to the left, ICH at column b - 1 inserts a blank
+ * cell and moves the cells from b on back to their columns. Afterwards only
+ * the cells which did not move with the row are printed. Both ways are encoded
+ * and the shorter one is used.
+ *
+ * Returns how many cells were printed.
+ */
+static size_t print_row(Encoder* e, Matrix* old, Matrix* new, size_t y) {
+  size_t width = matrix_width(new);
+  Cell* row_old = matrix_cell_at(old, 0, y);
+  if (!(e->caps & TERM_CAP_DCH)) {
+    return print_row_diff(e, row_old, new, y);
+  }
+
+  Cell* row_new = matrix_cell_at(new, 0, y);
+  size_t a = cells_find_diff(row_old, row_new, 0, width);
+  size_t b = width;
+  while (b > a && cell_eq(row_old + b - 1, row_new + b - 1)) {
+    --b;
+  }
+  if (b - a < 2) {
+    return print_row_diff(e, row_old, new, y);
+  }
+
+  if (e->shifted_width < width) {
+    free(e->shifted);
+    e->shifted = malloc(width * sizeof(Cell));
+    if (e->shifted == NULL) {
+      exit(1);
+    }
+    e->shifted_width = width;
+  }
+  Cell* shifted = e->shifted;
+  memcpy(shifted, row_old, width * sizeof(Cell));
+  memmove(shifted + a, row_old + a + 1, (b - a - 1) * sizeof(Cell));
+  shifted[b - 1] = unknown_cell;
+  if (count_changed(shifted + a, row_new + a, b - a) >=
+      count_changed(row_old + a, row_new + a, b - a)) {
+    return print_row_diff(e, row_old, new, y);
+  }
+
+  Encoder plain = *e;
+  plain.out = &e->trial;
+  buffer_clear(plain.out);
+  size_t plain_printed = print_row_diff(&plain, row_old, new, y);
+
+  Encoder shift = *e;
+  shift.out = &e->trial_shifted;
+  buffer_clear(shift.out);
+  encoder_move_to(&shift, new, a, y);
+  append_csi(shift.out, 1, 'P');
+  if (b < width) {
+    encoder_move_to(&shift, new, b - 1, y);
+    append_csi(shift.out, 1, '@');
+  }
+  size_t shift_printed = print_row_diff(&shift, shifted, new, y);
+
+  Encoder* best = shift.out->length < plain.out->length ? &shift : &plain;
+  buffer_append(e->out, best->out->data, best->out->length);
+  /* Only take over what the terminal looks like. The copies still hold the
+   * scratch buffers from before the trials, which may have been reallocated
+   * since. */
+  e->cursor_known = best->cursor_known;
+  e->x = best->x;
+  e->y = best->y;
+  e->text_color = best->text_color;
+  e->background_color = best->background_color;
+  return best == &shift ? shift_printed : plain_printed;
+}
+
+/* Move the cursor to the last column of the last row. */
+static void park_cursor(Encoder* e, Matrix* m) {
+  if (matrix_width(m) > 0 && matrix_height(m) > 0) {
+    encoder_move_to(e, m, matrix_width(m) - 1, matrix_height(m) - 1);
+  }
+}
+
+size_t encoder_print_update(Encoder* e, Matrix* old, Matrix* new) {
+  size_t printed = 0;
+  for (size_t y = 0; y < matrix_height(new); ++y) {
+    printed += print_row(e, old, new, y);
+  }
+  park_cursor(e, new);
+  return printed;
+}
+
+static int compare_positions(const void* a, const void* b) {
+  const Size2* p = a;
+  const Size2* q = b;
+  if (p->y != q->y) {
+    return p->y < q->y ? -1 : 1;
+  }
+  if (p->x != q->x) {
+    return p->x < q->x ? -1 : 1;
+  }
+  return 0;
+}
+
+size_t encoder_print_cells(Encoder* e, Matrix* old, Matrix* new,
+                           Size2* positions, size_t count) {
+  qsort(positions, count, sizeof(Size2), compare_positions);
+  size_t printed = 0;
+  size_t i = 0;
+  while (i < count) {
+    size_t x = positions[i].x;
+    size_t y = positions[i].y;
+    if (e->caps & TERM_CAP_DCH) {
+      /* Shifting needs the whole row, but only rows with changes. */
+      printed += print_row(e, old, new, y);
+      while (i < count && positions[i].y == y) {
+        ++i;
+      }
+      continue;
+    }
+    size_t n = 1;
+    Cell* row_old = matrix_cell_at(old, 0, y);
+    Cell* row_new = matrix_cell_at(new, 0, y);
+    if (!cell_eq(row_old + x, row_new + x)) {
+      if (e->caps & (TERM_CAP_REP | TERM_CAP_ECH)) {
+        n = run_length(row_old, new, x, y);
+      }
+      n = print_run(e, new, x, y, n);
+      printed += count_changed(row_old + x, row_new + x, n);
+    }
+    /* Skip the positions which the run covered. */
+    ++i;
+    while (i < count && positions[i].y == y && positions[i].x < x + n) {
+      ++i;
+    }
+  }
+  park_cursor(e, new);
+  return printed;
+}
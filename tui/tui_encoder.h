@@ -0,0 +1,80 @@
+#ifndef TUI_ENCODER_H
+#define TUI_ENCODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./tui_buffer.h"
+#include "./tui_io.h"
+#include "./tui_matrix.h"
+
+/* Turns the differences between two matrices into ANSI codes.
+ *
+ * The encoder remembers where the terminal cursor is and which colors are
+ * active. So it only prints colors when they change, and it moves the cursor
+ * to the next cell with the shortest of:
+ *
+ * - an absolute position `ESC[row;colH`,
+ * - relative moves up, down, forward and backward (CUU, CUD, CUF, CUB),
+ * - a carriage return followed by a forward move,
+ * - printing the cells in between again, if there are only a few.
+ *
+ * Runs of equal cells are printed with a single repeat (REP) or erase (ECH)
+ * code if the terminal understands it, e.g. rows of black background. Rows
+ * whose content moved one column to the left are shifted on the terminal
+ * with DCH and ICH, if that is shorter.
+ */
+typedef struct Encoder {
+  Buffer* out;       /* Where the ANSI codes are appended to. */
+  unsigned caps;     /* The `TermCaps` which may be used. */
+  bool cursor_known; /* If false, `x` and `y` are meaningless. */
+  size_t x;          /* The column of the terminal cursor. */
+  size_t y;          /* The row of the terminal cursor. */
+  const char* text_color;       /* The active colors, NULL if unknown. */
+  const char* background_color;
+  Cell* shifted;        /* Scratch row for shifting a row. */
+  size_t shifted_width; /* How many cells `shifted` has room for. */
+  Buffer trial;         /* Scratch buffers for encoding a row in two ways. */
+  Buffer trial_shifted;
+} Encoder;
+
+/* Initialize `e` to append to `out` using the optional ANSI codes in `caps`.
+ * Cursor position and colors are unknown.
+ */
+void encoder_init(Encoder* e, Buffer* out, unsigned caps);
+
+/* Deallocate the scratch buffers of `e`. */
+void encoder_free(Encoder* e);
+
+/* Forget the cursor position and colors, e.g. because something else was
+ * printed to the terminal.
+ */
+void encoder_reset(Encoder* e);
+
+/* Move the cursor to (x, y). `m` is the matrix which is being printed, its
+ * cells may be printed again on the way.
+ */
+void encoder_move_to(Encoder* e, Matrix* m, size_t x, size_t y);
+
+/* Move the cursor to (x, y) and print the cell of `m` at that position. */
+void encoder_print_cell(Encoder* e, Matrix* m, size_t x, size_t y);
+
+/* For each cell in `new`, which is different from the corresponding cell in
+ * `old`, print the cell from `new`. `old` is not modified, the caller is
+ * expected to use `new` as the current state of the terminal afterwards.
+ *
+ * Afterwards the cursor is moved to the last column of the last row.
+ *
+ * Returns how many cells were printed.
+ */
+size_t encoder_print_update(Encoder* e, Matrix* old, Matrix* new);
+
+/* Like `encoder_print_update`, but only compares the `count` cells at
+ * `positions` instead of all cells. Each position must occur at most once.
+ * The positions are sorted by row and column, so the cursor only has to move
+ * a short distance between them.
+ */
+size_t encoder_print_cells(Encoder* e, Matrix* old, Matrix* new,
+                           Size2* positions, size_t count);
+
+#endif /* TUI_ENCODER_H */
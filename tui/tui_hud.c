@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "./tui.h"
+#include "./tui_hud.h"
+
+/* Write the decimal representation of `value` to `out` without terminating 0.
+ * Returns how many characters were written.
+ */
+static size_t format_int(char* out, long value) {
+  char digits[HUD_VALUE_LENGTH];
+  char* p = digits + sizeof(digits);
+  /* Negate as unsigned, so the smallest `long` works, too. */
+  unsigned long n = value < 0 ? -(unsigned long)value : (unsigned long)value;
+  do {
+    *--p = '0' + n % 10;
+    n /= 10;
+  } while (n > 0);
+  if (value < 0) {
+    *--p = '-';
+  }
+  size_t length = digits + sizeof(digits) - p;
+  memcpy(out, p, length);
+  return length;
+}
+
+void hud_init(Hud* h, size_t x, size_t y, size_t x_end, size_t gap,
+              const char* text_color, const char* background_color) {
+  *h = (Hud){.count = 0,
+             .x = x,
+             .y = y,
+             .x_end = x_end,
+             .gap = gap,
+             .text_color = text_color,
+             .background_color = background_color,
+             .end = x};
+}
+
+size_t hud_add_field(Hud* h, const char* label) {
+  /* Same check as in `tui_layer_cell_at`, but also in release builds: it is
+   * only done once per field, and the fields would be written past the end
+   * of `fields` otherwise. */
+  if (h->count >= HUD_MAX_FIELDS) {
+    tui_shutdown();
+    printf(FG_RED "ASSERTION FAILED: the HUD already has %d fields, the "
+                  "maximum, so \"%s\" can not be added.\n\n" COLOR_RESET,
+           HUD_MAX_FIELDS, label);
+    fflush(stdout);
+    int* null = NULL;
+    *null = 42;
+  }
+  HudField* f = &h->fields[h->count];
+  *f = (HudField){.label = label,
+                  .label_length = strlen(label),
+                  .value = 0,
+                  .changed = true,
+                  .x = SIZE_MAX,
+                  .width = 0};
+  f->digit_count = format_int(f->digits, 0);
+  return h->count++;
+}
+
+void hud_set(Hud* h, size_t field, long value) {
+  HudField* f = &h->fields[field];
+  if (f->value != value) {
+    f->value = value;
+    f->digit_count = format_int(f->digits, value);
+    f->changed = true;
+  }
+}
+
+/* Draw `length` characters of `s` at column `x` of the HUD. */
+static void draw_text(Hud* h, size_t x, const char* s, size_t length) {
+  for (size_t i = 0; i < length && x + i < h->x_end; ++i) {
+    *tui_layer_cell_at(TUI_LAYER_HUD, x + i, h->y) =
+        (Cell){.content = s[i],
+               .text_color = h->text_color,
+               .background_color = h->background_color};
+  }
+}
+
+void hud_draw(Hud* h) {
+  size_t x = h->x;
+  for (size_t i = 0; i < h->count; ++i) {
+    HudField* f = &h->fields[i];
+    bool last = i + 1 == h->count;
+    size_t label_length = f->label_length;
+    size_t digit_count = f->digit_count;
+    size_t width = label_length + digit_count + (last ? 0 : h->gap);
+
+    if (f->x != x || f->width != width) {
+      /* The field is new or has moved, e.g. because the value in front of it
+       * got another digit. */
+      draw_text(h, x, f->label, label_length);
+      draw_text(h, x + label_length, f->digits, digit_count);
+      for (size_t g = label_length + digit_count; g < width; ++g) {
+        draw_text(h, x + g, " ", 1);
+      }
+    } else if (f->changed) {
+      draw_text(h, x + label_length, f->digits, digit_count);
+    }
+    f->changed = false;
+    f->x = x;
+    f->width = width;
+    x += width;
+  }
+
+  /* The fields got shorter, so the cells behind them become transparent. */
+  for (size_t c = x; c < h->end && c < h->x_end; ++c) {
+    *tui_layer_cell_at(TUI_LAYER_HUD, c, h->y) =
+        (Cell){.content = 0, .text_color = "", .background_color = ""};
+  }
+  h->end = x;
+}
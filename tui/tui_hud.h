@@ -0,0 +1,63 @@
+#ifndef TUI_HUD_H
+#define TUI_HUD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* How many fields a HUD can have. */
+#define HUD_MAX_FIELDS 8
+
+/* Enough for the digits and sign of any `long`. */
+#define HUD_VALUE_LENGTH 21
+
+/* A labeled integer on the HUD, e.g. "POINTS: 42". */
+typedef struct HudField {
+  const char* label;   /* The text in front of the value, e.g. "POINTS: ". */
+  size_t label_length;
+  long value;
+  char digits[HUD_VALUE_LENGTH]; /* `value` formatted when it was set, so
+                                    unchanged fields are not formatted again
+                                    for every frame. Not terminated by 0. */
+  size_t digit_count;
+  bool changed;      /* True iff `value` has not been drawn yet. */
+  size_t x;          /* The column where the field was drawn, or `SIZE_MAX`. */
+  size_t width;      /* How many cells the field was drawn with. */
+} HudField;
+
+/* A row of fields on the HUD layer, separated by gaps.
+ *
+ * Fields are only drawn when their value changes, and then only the cells of
+ * the value. Fields after a value which got more or less digits are moved,
+ * all other cells of the HUD layer stay untouched.
+ */
+typedef struct Hud {
+  HudField fields[HUD_MAX_FIELDS];
+  size_t count;
+  size_t x; /* The column of the first field. */
+  size_t y; /* The row of all fields. */
+  size_t x_end; /* Fields are cut off at this column, e.g. the terminal width. */
+  size_t gap; /* How many spaces are between two fields. */
+  const char* text_color;
+  const char* background_color;
+  size_t end; /* One past the last column drawn. */
+} Hud;
+
+/* Initialize `h` to have no fields and to draw them starting at (x, y). The
+ * fields are separated by `gap` spaces and cut off at column `x_end`.
+ */
+void hud_init(Hud* h, size_t x, size_t y, size_t x_end, size_t gap,
+              const char* text_color, const char* background_color);
+
+/* Add a field with `label` after the other fields. The label is not copied.
+ * Returns the index of the new field for `hud_set`. At most `HUD_MAX_FIELDS`
+ * fields can be added, the program is stopped otherwise.
+ */
+size_t hud_add_field(Hud* h, const char* label);
+
+/* Set the value of the field with index `field`. */
+void hud_set(Hud* h, size_t field, long value);
+
+/* Draw the fields which have changed since the last call on the HUD layer. */
+void hud_draw(Hud* h);
+
+#endif /* TUI_HUD_H */
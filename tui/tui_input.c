@@ -0,0 +1,122 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "./tui_input.h"
+#include "./tui_io.h"
+
+/* How many keys fit into the queue. Has to be a power of two. */
+#define QUEUE_SIZE 256
+
+/* How many keys are read from stdin at once. */
+#define READ_BATCH 64
+
+/* A single-producer single-consumer ring buffer. The input thread only writes
+ * `tail` and the thread calling `input_next` only writes `head`, so neither
+ * needs a lock. Both only grow, the slot of an index is `index % QUEUE_SIZE`.
+ */
+static KeyEvent queue[QUEUE_SIZE];
+static _Atomic size_t head; /* The next key to take. */
+static _Atomic size_t tail; /* Where the next key is put. */
+
+static atomic_bool closed;
+
+static pthread_t thread;
+
+/* A pipe which wakes the input thread up when it has to stop, because it
+ * would otherwise wait for the next key forever. */
+static int wake_fds[2];
+
+/* Append `e` to the queue, or drop it if the queue is full. */
+static void push(KeyEvent e) {
+  size_t t = atomic_load_explicit(&tail, memory_order_relaxed);
+  if (t - atomic_load_explicit(&head, memory_order_acquire) == QUEUE_SIZE) {
+    return;
+  }
+  queue[t % QUEUE_SIZE] = e;
+  atomic_store_explicit(&tail, t + 1, memory_order_release);
+}
+
+static void* input_thread(void* arg) {
+  (void)arg;
+  struct pollfd fds[2] = {{.fd = fileno(stdin), .events = POLLIN},
+                          {.fd = wake_fds[0], .events = POLLIN}};
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents != 0) {
+      break;
+    }
+    char keys[READ_BATCH];
+    int count = read_all_from_stdin(keys, sizeof(keys));
+    if (count < 0) {
+      break;
+    }
+    /* All keys of a read arrived at the same time, as far as we can tell. */
+    uint64_t time = clock_now();
+    for (int i = 0; i < count; ++i) {
+      push((KeyEvent){.key = keys[i], .time = time});
+    }
+  }
+  atomic_store(&closed, true);
+  return NULL;
+}
+
+void input_start(void) {
+  atomic_store(&head, 0);
+  atomic_store(&tail, 0);
+  atomic_store(&closed, false);
+  /* Keys pressed while `tui_init` asked the terminal come first. They have
+   * been waiting since before now, so any step takes them. */
+  char keys[READ_BATCH];
+  size_t count;
+  while ((count = take_unread_keys(keys, sizeof(keys))) > 0) {
+    for (size_t i = 0; i < count; ++i) {
+      push((KeyEvent){.key = keys[i], .time = 0});
+    }
+  }
+  if (pipe(wake_fds) != 0) {
+    wake_fds[0] = wake_fds[1] = -1;
+    atomic_store(&closed, true);
+    return;
+  }
+  if (pthread_create(&thread, NULL, input_thread, NULL) != 0) {
+    close(wake_fds[0]);
+    close(wake_fds[1]);
+    wake_fds[0] = wake_fds[1] = -1;
+    atomic_store(&closed, true);
+  }
+}
+
+void input_stop(void) {
+  char c = 0;
+  if (write(wake_fds[1], &c, 1) == 1) {
+    pthread_join(thread, NULL);
+  }
+  close(wake_fds[0]);
+  close(wake_fds[1]);
+}
+
+bool input_next(KeyEvent* e, uint64_t time) {
+  size_t h = atomic_load_explicit(&head, memory_order_relaxed);
+  if (h == atomic_load_explicit(&tail, memory_order_acquire)) {
+    return false;
+  }
+  if (queue[h % QUEUE_SIZE].time >= time) {
+    return false;
+  }
+  *e = queue[h % QUEUE_SIZE];
+  atomic_store_explicit(&head, h + 1, memory_order_release);
+  return true;
+}
+
+bool input_closed(void) {
+  return atomic_load(&closed);
+}
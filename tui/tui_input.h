@@ -0,0 +1,38 @@
+#ifndef TUI_INPUT_H
+#define TUI_INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A key pressed by the user. */
+typedef struct KeyEvent {
+  char key;
+  uint64_t time; /* When the key arrived, see `clock_now`. */
+} KeyEvent;
+
+/* Start the input thread, which waits for keys on stdin and collects them
+ * with the time of their arrival. The terminal has to be in raw mode, see
+ * `tui_init`. Keys which `tui_init` read while it asked the terminal for its
+ * capabilities are returned first.
+ *
+ * The keys are passed to the thread calling `input_next` through a lock-free
+ * queue. If that thread does not take them, e.g. because it is stuck, keys
+ * which no longer fit into the queue are dropped.
+ */
+void input_start(void);
+
+/* Stop the input thread. Keys which were not taken yet are discarded. */
+void input_stop(void);
+
+/* Take the oldest key which arrived before `time` and store it in `*e`.
+ * Returns false if there is no such key, keys which arrived later are kept
+ * for later calls.
+ */
+bool input_next(KeyEvent* e, uint64_t time);
+
+/* Returns true if stdin can not be read anymore, e.g. because the terminal
+ * was closed, or if the input thread could not be started. Keys which arrived before are still returned by `input_next`.
+ */
+bool input_closed(void);
+
+#endif /* TUI_INPUT_H */
@@ -1,9 +1,12 @@
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/select.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "./tui_io.h"
@@ -47,13 +50,38 @@ bool stdin_has_changed(void) {
 int read_from_stdin(void) {
   int r;
   unsigned char c;
-  if ((r = read(fileno(stdin), &c, sizeof(c))) < 0) {
-    return r;
+  if ((r = read(fileno(stdin), &c, sizeof(c))) <= 0) {
+    /* Error, or end of file if the terminal was closed. */
+    return -1;
   } else {
     return c;
   }
 }
 
+uint64_t clock_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void sleep_until(uint64_t time) {
+  struct timespec deadline = {.tv_sec = time / 1000000000ULL,
+                              .tv_nsec = time % 1000000000ULL};
+  /* The deadline is absolute, so we simply sleep again after a signal. */
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) ==
+         EINTR) {
+  }
+}
+
+int read_all_from_stdin(char* keys, size_t capacity) {
+  ssize_t r = read(fileno(stdin), keys, capacity);
+  if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    /* stdin shares the non-blocking mode of stdout, see `output_start`. */
+    return 0;
+  }
+  return r > 0 ? r : -1;
+}
+
 Size2 query_size(void) {
   struct winsize w;
 
@@ -61,3 +89,152 @@ Size2 query_size(void) {
 
   return (Size2){.x = w.ws_col, .y = w.ws_row};
 }
+
+/* Terminals whose `TERM` starts with `prefix` understand the ANSI codes in
+ * `caps`.
+ */
+static const struct {
+  const char* prefix;
+  unsigned caps;
+} known_terms[] = {
+    /* Many terminals call themselves xterm without repeating characters, see
+     * `repeats_characters`. */
+    {"xterm", TERM_CAP_ECH | TERM_CAP_DCH},
+    {"foot", TERM_CAP_REP | TERM_CAP_ECH | TERM_CAP_DCH},
+    {"alacritty", TERM_CAP_REP | TERM_CAP_ECH | TERM_CAP_DCH},
+    {"wezterm", TERM_CAP_REP | TERM_CAP_ECH | TERM_CAP_DCH},
+    {"tmux", TERM_CAP_REP | TERM_CAP_ECH | TERM_CAP_DCH},
+    /* The Linux console and rxvt do not repeat characters. screen is missing
+     * on purpose: it erases with the default background color. */
+    {"linux", TERM_CAP_ECH | TERM_CAP_DCH},
+    {"rxvt", TERM_CAP_ECH | TERM_CAP_DCH},
+};
+
+/* How long to wait for the terminal to answer a query. */
+#define QUERY_TIMEOUT_MS 250
+
+/* How many bytes of the answer and keys are read at most. */
+#define QUERY_ANSWER_SIZE 256
+
+static long now_ms(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+QueryReply parse_query_reply(const char* in, size_t n, char* keys) {
+  QueryReply r = {.sync_output = false, .complete = false, .key_count = 0};
+  size_t i = 0;
+  while (i < n) {
+    /* Both replies are `ESC[?`, numbers separated by `;` and a final `c` for
+     * the attributes or `$y` for the mode. */
+    if (n - i >= 3 && memcmp(in + i, "\e[?", 3) == 0) {
+      size_t j = i + 3;
+      while (j < n && ((in[j] >= '0' && in[j] <= '9') || in[j] == ';')) {
+        ++j;
+      }
+      if (j < n && in[j] == 'c') {
+        r.complete = true;
+        i = j + 1;
+        continue;
+      }
+      if (j + 1 < n && in[j] == '$' && in[j + 1] == 'y') {
+        if (j - i == 9 && memcmp(in + i + 3, "2026;", 5) == 0 &&
+            (in[i + 8] == '1' || in[i + 8] == '2')) {
+          r.sync_output = true;
+        }
+        i = j + 2;
+        continue;
+      }
+    }
+    keys[r.key_count++] = in[i++];
+  }
+  return r;
+}
+
+/* Keys which the user pressed while `query_caps` waited for the terminal. */
+static char unread_keys[QUERY_ANSWER_SIZE];
+static size_t unread_key_count;
+
+size_t take_unread_keys(char* keys, size_t capacity) {
+  size_t n = unread_key_count < capacity ? unread_key_count : capacity;
+  memcpy(keys, unread_keys, n);
+  memmove(unread_keys, unread_keys + n, unread_key_count - n);
+  unread_key_count -= n;
+  return n;
+}
+
+/* Returns true iff the terminal knows the DEC private mode 2026, which
+ * enables synchronized output.
+ *
+ * We ask for the mode with DECRQM, followed by a request for the primary
+ * device attributes, which every terminal answers. Terminals which know the
+ * mode answer `ESC[?2026;Ns$y` before the attributes, with N being 1 or 2 if
+ * the mode can be set. So if the attributes arrive first, we do not have to
+ * wait for the timeout. Keys which arrive in between are kept for
+ * `take_unread_keys`.
+ */
+static bool query_sync_output(void) {
+  printf("\e[?2026$p\e[c");
+  fflush(stdout);
+
+  char answer[QUERY_ANSWER_SIZE];
+  size_t length = 0;
+  QueryReply reply = {.complete = false};
+  long deadline = now_ms() + QUERY_TIMEOUT_MS;
+  while (length < sizeof(answer) && !reply.complete) {
+    long remaining = deadline - now_ms();
+    struct pollfd p = {.fd = fileno(stdin), .events = POLLIN};
+    if (remaining <= 0 || poll(&p, 1, remaining) <= 0) {
+      break;
+    }
+    ssize_t n = read(fileno(stdin), answer + length, sizeof(answer) - length);
+    if (n <= 0) {
+      break;
+    }
+    length += n;
+    reply = parse_query_reply(answer, length, unread_keys);
+  }
+  unread_key_count = reply.key_count;
+  return reply.sync_output;
+}
+
+/* Returns true iff the terminal is known to understand `TERM_CAP_REP` although
+ * its `TERM` does not tell, or if the user enabled it with `TUI_REP=1`.
+ * `TUI_REP=0` disables it for every terminal.
+ */
+static bool repeats_characters(unsigned caps) {
+  const char* rep = getenv("TUI_REP");
+  if (rep != NULL) {
+    return strcmp(rep, "1") == 0;
+  }
+  /* Only the real xterm sets this. */
+  return (caps & TERM_CAP_REP) || getenv("XTERM_VERSION") != NULL;
+}
+
+unsigned term_caps(const char* term) {
+  unsigned caps = 0;
+  if (term != NULL) {
+    for (size_t i = 0; i < sizeof(known_terms) / sizeof(known_terms[0]); ++i) {
+      const char* prefix = known_terms[i].prefix;
+      if (strncmp(term, prefix, strlen(prefix)) == 0) {
+        caps = known_terms[i].caps;
+        break;
+      }
+    }
+  }
+  if (repeats_characters(caps)) {
+    caps |= TERM_CAP_REP;
+  } else {
+    caps &= ~TERM_CAP_REP;
+  }
+  return caps;
+}
+
+unsigned query_caps(void) {
+  unsigned caps = term_caps(getenv("TERM"));
+  if (query_sync_output()) {
+    caps |= TERM_CAP_SYNC;
+  }
+  return caps;
+}
@@ -2,6 +2,9 @@
 #define TUI_IO_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 
 /* Set the terminal to raw mode.
  *
@@ -41,6 +44,23 @@ bool stdin_has_changed(void);
  */
 int read_from_stdin(void);
 
+/* Returns the time of the clock `CLOCK_MONOTONIC` in nanoseconds. */
+uint64_t clock_now(void);
+
+/* Sleep until `clock_now` reaches `time`. Returns at once if it already has.
+ */
+void sleep_until(uint64_t time);
+
+/* Read all keys the user has pressed, but at most `capacity`, into `keys` with
+ * a single system call. Returns how many keys were read, or -1 if stdin can
+ * not be read anymore, e.g. because the terminal was closed.
+ *
+ * Like `read_from_stdin`, this only returns keys without blocking after
+ * `stdin_has_changed` returned true or `poll` reported stdin as readable, as
+ * the input thread does, see `input_start`.
+ */
+int read_all_from_stdin(char* keys, size_t capacity);
+
 /* A pair of size_t values. */
 typedef struct Size2 {
   size_t x;
@@ -52,4 +72,57 @@ typedef struct Size2 {
  */
 Size2 query_size(void);
 
+/* Optional ANSI codes, which not every terminal understands. */
+typedef enum TermCaps {
+  TERM_CAP_REP = 1 << 0, /* `ESC[nb` repeats the previous character n times. */
+  TERM_CAP_ECH = 1 << 1, /* `ESC[nX` erases n characters with the current
+                            background color. */
+  TERM_CAP_DCH = 1 << 2, /* `ESC[nP` deletes and `ESC[n@` inserts n characters
+                            and moves the rest of the row. */
+  TERM_CAP_SYNC = 1 << 3, /* `ESC[?2026h` and `ESC[?2026l` enclose a frame,
+                             which the terminal then shows at once. */
+} TermCaps;
+
+/* Returns the `TermCaps` of a terminal whose `TERM` is `term`, which may be
+ * NULL, without asking the terminal.
+ *
+ * Unknown terminals get no capabilities, so only the basic ANSI codes are
+ * used for them. Characters are only repeated on terminals known to support
+ * it, not on every `xterm*`, which many terminals claim to be; `TUI_REP=1` or
+ * `TUI_REP=0` in the environment overrides this.
+ */
+unsigned term_caps(const char* term);
+
+/* Returns the `TermCaps` of the terminal, combined with `|`.
+ *
+ * Most capabilities are looked up by the name of the terminal in the `TERM`
+ * environment variable, see `term_caps`.
+ *
+ * Synchronized output is detected by asking the terminal, which has to be in
+ * raw mode. Terminals which do not answer within a short time are treated as
+ * not supporting it.
+ */
+unsigned query_caps(void);
+
+/* Move up to `capacity` keys, which the user pressed while `query_caps` waited
+ * for the terminal to answer, into `keys`. Returns how many keys were moved.
+ * The input thread takes them before it reads stdin, see `input_start`.
+ */
+size_t take_unread_keys(char* keys, size_t capacity);
+
+/* What `parse_query_reply` found in the answer to the queries of
+ * `query_caps`. */
+typedef struct QueryReply {
+  bool sync_output; /* The terminal can enable synchronized output. */
+  bool complete;    /* The device attributes arrived, which come last. */
+  size_t key_count; /* How many bytes did not belong to a reply. */
+} QueryReply;
+
+/* Split the `n` bytes at `in`, which stdin returned after the queries, into
+ * the replies of the terminal and the keys pressed by the user, which are
+ * copied to `keys` in their order. `keys` needs room for `n` bytes. A reply
+ * which has not arrived completely yet is counted as keys.
+ */
+QueryReply parse_query_reply(const char* in, size_t n, char* keys);
+
 #endif /* TUI_IO_H */
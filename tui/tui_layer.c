@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "./tui_layer.h"
+
+Damage* damage_new(size_t width, size_t height) {
+  Damage* d = malloc(sizeof(Damage));
+  if (d == NULL) {
+    return NULL;
+  }
+
+  *d = (Damage){.positions = malloc(width * height * sizeof(Size2)),
+                .count = 0,
+                .marked = calloc(width * height, sizeof(bool)),
+                .width = width,
+                .height = height,
+                .full = false};
+
+  if (d->positions == NULL || d->marked == NULL) {
+    damage_free(d);
+    return NULL;
+  }
+
+  return d;
+}
+
+void damage_free(Damage* d) {
+  free(d->positions);
+  free(d->marked);
+  free(d);
+}
+
+void damage_add_from(Damage* d, Damage* src) {
+  if (src->full) {
+    damage_add_all(d);
+    return;
+  }
+  for (size_t i = 0; i < src->count; ++i) {
+    damage_add(d, src->positions[i].x, src->positions[i].y);
+  }
+}
+
+void damage_add_all(Damage* d) {
+  damage_reset(d);
+  d->full = true;
+}
+
+bool damage_is_full(Damage* d) {
+  return d->full;
+}
+
+size_t damage_count(Damage* d) {
+  return d->count;
+}
+
+Size2* damage_positions(Damage* d) {
+  return d->positions;
+}
+
+void damage_reset(Damage* d) {
+  for (size_t i = 0; i < d->count; ++i) {
+    Size2 p = d->positions[i];
+    d->marked[p.y * d->width + p.x] = false;
+  }
+  d->count = 0;
+  d->full = false;
+}
+
+void damage_resize(Damage* d, size_t width, size_t height) {
+  free(d->positions);
+  free(d->marked);
+  d->positions = malloc(width * height * sizeof(Size2));
+  d->marked = calloc(width * height, sizeof(bool));
+  d->width = width;
+  d->height = height;
+  d->count = 0;
+  d->full = true;
+}
+
+/* Cell which lets the cell of the layer below show through. */
+static Cell transparent_cell =
+    (Cell){.content = 0, .text_color = "", .background_color = ""};
+
+Layer* layer_new(size_t width, size_t height) {
+  Layer* l = malloc(sizeof(Layer));
+  if (l == NULL) {
+    return NULL;
+  }
+
+  *l = (Layer){.cells = matrix_new(width, height, &transparent_cell),
+               .drawn = damage_new(width, height),
+               .taken = 0};
+
+  if (l->cells == NULL || l->drawn == NULL) {
+    free(l);
+    return NULL;
+  }
+
+  return l;
+}
+
+void layer_free(Layer* l) {
+  matrix_free(l->cells);
+  damage_free(l->drawn);
+  free(l);
+}
+
+void layer_set_cells(Layer* l, size_t x, size_t y, const Cell* cells, size_t n,
+                     Damage* d) {
+  memcpy(matrix_cell_at(l->cells, x, y), cells, n * sizeof(Cell));
+  for (size_t i = 0; i < n; ++i) {
+    layer_mark(l, x + i, y, d);
+  }
+}
+
+void layer_take_drawn(Layer* l, Damage* d) {
+  Size2* positions = damage_positions(l->drawn);
+  for (size_t i = l->taken; i < damage_count(l->drawn); ++i) {
+    damage_add(d, positions[i].x, positions[i].y);
+  }
+  l->taken = damage_count(l->drawn);
+}
+
+const Cell* layer_get(Layer* l, size_t x, size_t y) {
+  return matrix_cell_at(l->cells, x, y);
+}
+
+void layer_clear(Layer* l, Damage* d) {
+  if (damage_is_full(l->drawn)) {
+    matrix_clear_with(l->cells, &transparent_cell);
+    damage_add_all(d);
+  } else {
+    Size2* positions = damage_positions(l->drawn);
+    for (size_t i = 0; i < damage_count(l->drawn); ++i) {
+      *matrix_cell_at(l->cells, positions[i].x, positions[i].y) =
+          transparent_cell;
+      damage_add(d, positions[i].x, positions[i].y);
+    }
+  }
+  damage_reset(l->drawn);
+  l->taken = 0;
+}
+
+void layer_resize(Layer* l, size_t width, size_t height) {
+  matrix_resize(l->cells, width, height, &transparent_cell);
+  damage_resize(l->drawn, width, height);
+  l->taken = 0;
+}
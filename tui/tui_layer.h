@@ -0,0 +1,141 @@
+#ifndef TUI_LAYER_H
+#define TUI_LAYER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./tui_io.h"
+#include "./tui_matrix.h"
+
+/* A set of cell positions, e.g. the cells which have to be compared with the
+ * terminal during the next update.
+ *
+ * Each position is stored at most once, so adding a position is cheap and the
+ * number of stored positions never exceeds the number of cells.
+ *
+ * The struct is only public, so `damage_add` can be inlined into the drawing
+ * loops. Use the functions instead of the members.
+ */
+typedef struct Damage {
+  Size2* positions; /* The damaged positions in the order they were added. */
+  size_t count;     /* How many positions are stored in `positions`. */
+  bool* marked;     /* `marked[y * width + x]` is true iff (x, y) is stored in
+                       `positions`. */
+  size_t width;
+  size_t height;
+  bool full; /* If true, every cell is damaged and `positions` is empty. */
+} Damage;
+
+/* Allocate a new, empty damage set for a matrix of size `width` x `height`. */
+Damage* damage_new(size_t width, size_t height);
+
+/* Deallocate a damage set. */
+void damage_free(Damage* d);
+
+/* Add position (x, y) to the set, if it is not already in there. */
+static inline void damage_add(Damage* d, size_t x, size_t y) {
+  bool* marked = d->marked + y * d->width + x;
+  if (d->full || *marked) {
+    return;
+  }
+  *marked = true;
+  d->positions[d->count++] = (Size2){.x = x, .y = y};
+}
+
+/* Add all positions of `src` to `d`. */
+void damage_add_from(Damage* d, Damage* src);
+
+/* Mark every cell as damaged. The individual positions are forgotten. */
+void damage_add_all(Damage* d);
+
+/* Returns true iff every cell is damaged. */
+bool damage_is_full(Damage* d);
+
+/* Returns how many positions have been added since the last reset.
+ * Returns 0 if the set is full, use `damage_is_full` to check for that case.
+ */
+size_t damage_count(Damage* d);
+
+/* Returns the positions in the order in which they were added. */
+Size2* damage_positions(Damage* d);
+
+/* Remove all positions from the set. */
+void damage_reset(Damage* d);
+
+/* Resize the set to a matrix of size `width` x `height`. Afterwards every cell
+ * is damaged.
+ */
+void damage_resize(Damage* d, size_t width, size_t height);
+
+/* A matrix of cells which is drawn on top of other layers.
+ *
+ * Cells whose `content` is 0 are transparent, i.e. the cell of the layer below
+ * shows through. A layer remembers which cells were drawn since it was cleared
+ * the last time, so clearing only touches those cells. The same record tells
+ * which cells have to be compared with the terminal, see `layer_take_drawn`,
+ * so drawing a cell only marks it once.
+ *
+ * Like `Damage`, the struct is only public for the inline functions.
+ */
+typedef struct Layer {
+  Matrix* cells;
+  Damage* drawn; /* The cells drawn since the last `layer_clear`. */
+  size_t taken;  /* How many positions of `drawn` `layer_take_drawn` has
+                    already reported. */
+} Layer;
+
+/* Allocate a new, fully transparent layer of size `width` x `height`. */
+Layer* layer_new(size_t width, size_t height);
+
+/* Deallocate a layer. */
+void layer_free(Layer* l);
+
+/* Remember that the cell at (x, y) is drawn. A cell drawn for the first time
+ * since the last clear is reported by the next `layer_take_drawn`. A cell
+ * which was already drawn is redrawn in place, so its position is added to
+ * `d` directly.
+ */
+static inline void layer_mark(Layer* l, size_t x, size_t y, Damage* d) {
+  Damage* drawn = l->drawn;
+  bool* marked = drawn->marked + y * drawn->width + x;
+  if (*marked || drawn->full) {
+    damage_add(d, x, y);
+  } else {
+    *marked = true;
+    drawn->positions[drawn->count++] = (Size2){.x = x, .y = y};
+  }
+}
+
+/* Retrieve the cell at (x, y) for drawing. The cell is remembered, such that
+ * the next `layer_clear` makes it transparent again, see `layer_mark`.
+ */
+static inline Cell* layer_cell_at(Layer* l, size_t x, size_t y, Damage* d) {
+  layer_mark(l, x, y, d);
+  return matrix_cell_at(l->cells, x, y);
+}
+
+/* Copy the `n` cells at `cells` into the row `y`, starting at column `x`.
+ * The cells are remembered like in `layer_cell_at`.
+ */
+void layer_set_cells(Layer* l, size_t x, size_t y, const Cell* cells, size_t n,
+                     Damage* d);
+
+/* Add the positions of the cells which were drawn for the first time since
+ * the last clear, and which no call reported yet, to `d`.
+ */
+void layer_take_drawn(Layer* l, Damage* d);
+
+/* Retrieve the cell at (x, y) for reading only. */
+const Cell* layer_get(Layer* l, size_t x, size_t y);
+
+/* Make all cells drawn since the last clear transparent again and add their
+ * positions to `d`.
+ */
+void layer_clear(Layer* l, Damage* d);
+
+/* Resize the layer. Cells outside of the new size are removed, new cells are
+ * transparent.
+ */
+void layer_resize(Layer* l, size_t width, size_t height);
+
+#endif /* TUI_LAYER_H */
@@ -7,25 +7,6 @@
 #include "./ansi_codes.h"
 #include "./tui_matrix.h"
 
-/* Representation of the terminal content as a matrix of `cells` for a terminal
- * which is large enough to display `width` x `height` characters.
- */
-struct Matrix {
-  Cell* cells;
-  size_t width;
-  size_t height;
-};
-
-void cell_print(Cell* c) {
-  printf("%s%s%c", c->text_color, c->background_color, c->content);
-}
-
-Cell* matrix_cell_at(Matrix* m, size_t x, size_t y) {
-  assert(x < m->width);
-  assert(y < m->height);
-  return m->cells + y * m->width + x;
-}
-
 Matrix* matrix_new(size_t width, size_t height, Cell* def) {
   Matrix* m = malloc(sizeof(Matrix));
   if (m == NULL) {
@@ -51,14 +32,6 @@ void matrix_free(Matrix* m) {
   free(m);
 }
 
-size_t matrix_width(Matrix* m) {
-  return m->width;
-}
-
-size_t matrix_height(Matrix* m) {
-  return m->height;
-}
-
 void matrix_clear_with(Matrix* m, Cell* c) {
   for (size_t y = 0; y < m->height; ++y)
     for (size_t x = 0; x < m->width; ++x)
@@ -90,28 +63,10 @@ void matrix_resize(Matrix* m, size_t width, size_t height, Cell* def) {
 
 bool cell_eq(Cell* c1, Cell* c2) {
   return c1->content == c2->content
-    && strcmp(c1->text_color, c2->text_color) == 0
-    && strcmp(c1->background_color, c2->background_color) == 0;
-}
-
-void matrix_print_update(Matrix* old, Matrix* new) {
-  assert(old->width == new->width);
-  assert(old->height == new->height);
-  for (size_t y = 0; y < new->height; ++y) {
-    for (size_t x = 0; x < new->width; ++x) {
-      Cell* cell_old = matrix_cell_at(old, x, y);
-      Cell* cell_new = matrix_cell_at(new, x, y);
-      if (!cell_eq(cell_old, cell_new)) {
-        move_cursor_to(x, y);
-        cell_print(cell_new);
-        *cell_old = *cell_new;
-      };
-    }
-  }
-  if (new->width > 0 && new->height > 0) {
-    move_cursor_to(new->width - 1, new->height - 1);
-  }
-  fflush(stdout);
+    && (c1->text_color == c2->text_color
+        || strcmp(c1->text_color, c2->text_color) == 0)
+    && (c1->background_color == c2->background_color
+        || strcmp(c1->background_color, c2->background_color) == 0);
 }
 
 void matrix_set_str_at(Matrix* m, size_t x, size_t y, const char* s,
@@ -1,16 +1,37 @@
 #ifndef TUI_INTERNAL_H
 #define TUI_INTERNAL_H
 
-/* Representation of a terminal cell at a certain (x,y) position. */
+#include <assert.h>
+#include <stdbool.h>
+
+#include "./tui_io.h"
+
+/* Representation of a terminal cell at a certain (x,y) position.
+ *
+ * The struct has no implicit padding bytes. Cells created with designated
+ * initializers like `(Cell){.content = ' ', ...}` have all bytes initialized,
+ * so two cells with equal bytes are always equal and rows of cells can be
+ * compared with `memcmp`-like functions.
+ */
 typedef struct Cell {
-  char content;           /* The character at this position */
   const char* text_color; /* ANSI Code for the text color of this character */
   const char* background_color; /* ANSI Code for the background color of this
                                    character */
+  char content;                 /* The character at this position */
+  char padding[sizeof(void*) - 1]; /* Always 0, see above. */
 } Cell;
 
-/* Representation of the terminal content as a matrix of `cells`. */
-typedef struct Matrix Matrix;
+/* Representation of the terminal content as a matrix of `cells` for a terminal
+ * which is large enough to display `width` x `height` characters.
+ *
+ * The struct is only public, so the accessors below can be inlined into the
+ * drawing loops. Use the functions instead of the members.
+ */
+typedef struct Matrix {
+  Cell* cells;
+  size_t width;
+  size_t height;
+} Matrix;
 
 /* Allocate a new matrix of size `width` x `height` where each cell is
  * initialized to be a copy of `def`.
@@ -27,16 +48,24 @@ void matrix_clear_with(Matrix* m, Cell* c);
 void matrix_clear(Matrix* m);
 
 /* Returns the width of the matrix. */
-size_t matrix_width(Matrix* m);
+static inline size_t matrix_width(Matrix* m) {
+  return m->width;
+}
 
 /* Returns the height of the matrix. */
-size_t matrix_height(Matrix* m);
+static inline size_t matrix_height(Matrix* m) {
+  return m->height;
+}
 
 /* Retrieve the Cell corresponding to the terminal character at column `x` and
  * row `y`. Uses `assert` to abort the program if `x` and `y` are not valid
- * indices.
+ * indices, so release builds with `NDEBUG` do not check the indices at all.
  */
-Cell* matrix_cell_at(Matrix* m, size_t x, size_t y);
+static inline Cell* matrix_cell_at(Matrix* m, size_t x, size_t y) {
+  assert(x < m->width);
+  assert(y < m->height);
+  return m->cells + y * m->width + x;
+}
 
 /* Write string `s` with styles `text_color` and `background_color` into the
  * matrix `m`, starting from position `(x, y)`. If the matrix row is not long
@@ -55,19 +84,9 @@ void matrix_set_str_at(Matrix* m, size_t x, size_t y, const char* s,
  */
 void matrix_resize(Matrix* m, size_t width, size_t height, Cell* def);
 
-/* For each cell in `new`, which is different from the corresponding cell in `old`:
- *
- * - print the cell from `new` with the correct color at the correct position;
- *
- * - update the corresponding cell in `old` to be equal to the cell in `new` to
- *   reflect the current state of the terminal;
- *
- * After the cells are redrawn and updated, the cursor position is moved to the
- * last column of the last row and stdout is flushed.
- *
- * Note: It does *not* make sense to use any linebreak like '\n' in the definition
- * of this function.
+/* Returns true iff `c1` and `c2` show the same character with the same
+ * colors.
  */
-void matrix_print_update(Matrix* old, Matrix* new);
+bool cell_eq(Cell* c1, Cell* c2);
 
 #endif /* TUI_INTERNAL_H */
@@ -0,0 +1,348 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./tui_encoder.h"
+#include "./tui_output.h"
+
+/* The triple buffer uses one more buffer than usual: the output thread keeps
+ * the frame it printed last as `front`, because the next frame is printed by
+ * comparing it with `front`. This way neither thread ever copies a frame.
+ */
+#define SLOT_COUNT 4
+
+/* Set in `middle` if the slot in there contains a frame which the output
+ * thread has not taken yet.
+ */
+#define FRESH 4u
+#define SLOT_MASK 3u
+
+static Frame slots[SLOT_COUNT];
+
+/* The slot which is exchanged between the threads, combined with `FRESH`. */
+static _Atomic unsigned middle;
+
+/* Only accessed by the drawing thread. */
+static unsigned back;            /* The slot which is drawn next. */
+static Damage* stale[SLOT_COUNT]; /* The cells of each slot which have changed
+                                     since the slot was drawn the last time. */
+static uint64_t next_seq;
+
+/* Only accessed by the output thread. */
+static unsigned front; /* The slot with the frame the terminal shows. */
+static unsigned spare; /* The slot the output thread puts into `middle` when it
+                          takes a new frame. */
+static Buffer out;     /* The ANSI codes of the frame which is printed. */
+static Encoder encoder; /* Knows the cursor and colors of the terminal. */
+
+static TuiSink sink;
+static unsigned caps; /* The `TermCaps` of the sink. */
+static Buffer memory; /* Everything printed to `TUI_SINK_MEMORY`. */
+static Video* video;  /* The recording of `TUI_SINK_VIDEO`. */
+
+/* The counters of `TuiStats`. They are written by the output thread and read
+ * by the drawing thread. */
+static atomic_uint_fast64_t printed_frames;
+static atomic_uint_fast64_t dropped_frames;
+static atomic_uint_fast64_t printed_bytes;
+static atomic_uint_fast64_t printed_escapes;
+static atomic_uint_fast64_t printed_cells;
+
+/* The file status flags of stdout before `output_start`. */
+static int stdout_flags;
+
+/* True if the output thread gave up on the last frame after `output_stop`
+ * before all of it was written. Only read after the thread was joined. */
+static bool cut_off;
+
+static pthread_t thread;
+static sem_t frame_ready;
+static atomic_bool running;
+
+/* Cell which is different from all regular cells.
+ *
+ * If `front` contains a `null_cell`, then the next frame will definitely
+ * redraw the cell at the same position.
+ */
+static Cell null_cell =
+    (Cell){.content = 0, .text_color = "", .background_color = ""};
+
+/* Begin and end of a synchronized update, see `TERM_CAP_SYNC`. */
+#define SYNC_BEGIN "\e[?2026h"
+#define SYNC_END "\e[?2026l"
+
+/* CAN aborts an escape sequence which was cut off in the middle. */
+#define CANCEL "\x18"
+
+/* How long the output thread keeps writing its frame after `output_stop`, if
+ * the terminal does not accept it any faster. */
+#define STOP_TIMEOUT_NS 500000000ULL
+
+/* Append the ANSI codes for the differences between the frame in slot `next`
+ * and the frame in slot `front` to `out`. Returns how many cells are printed.
+ */
+static size_t encode_cells(unsigned next) {
+  Frame* f = &slots[next];
+  /* Only if we printed the frame directly before `f`, the cells which may
+   * have changed are known. Otherwise all cells are compared. */
+  if (slots[front].seq + 1 == f->seq && !damage_is_full(f->changed)) {
+    return encoder_print_cells(&encoder, slots[front].cells, f->cells,
+                               damage_positions(f->changed),
+                               damage_count(f->changed));
+  } else {
+    return encoder_print_update(&encoder, slots[front].cells, f->cells);
+  }
+}
+
+/* Like `encode_cells`, but if the terminal supports synchronized output, the
+ * frame is enclosed in a synchronized update. The terminal then shows the
+ * frame at once instead of repainting while it arrives.
+ */
+static size_t encode_frame(unsigned next) {
+  if (!(caps & TERM_CAP_SYNC)) {
+    return encode_cells(next);
+  }
+  buffer_append_str(&out, SYNC_BEGIN);
+  size_t cells = encode_cells(next);
+  if (out.length == strlen(SYNC_BEGIN)) {
+    /* Nothing changed, so there is nothing to synchronize. */
+    buffer_clear(&out);
+  } else {
+    buffer_append_str(&out, SYNC_END);
+  }
+  return cells;
+}
+
+/* Rasterize the frame in slot `next` and append it to `video`. Like with
+ * `encode_cells`, only the cells which may have changed are rasterized if the
+ * video ends with the frame directly before. Returns how many bytes were
+ * written, `*cells` is set to how many cells were rasterized.
+ */
+static size_t record_frame(unsigned next, size_t* cells) {
+  Frame* f = &slots[next];
+  if (slots[front].seq + 1 == f->seq && !damage_is_full(f->changed)) {
+    *cells = damage_count(f->changed);
+    return video_write_frame(video, f->cells, damage_positions(f->changed),
+                             *cells);
+  }
+  *cells = matrix_width(f->cells) * matrix_height(f->cells);
+  return video_write_frame(video, f->cells, NULL, 0);
+}
+
+/* Returns how many ANSI escape sequences are in `out`. */
+static size_t count_escapes(void) {
+  size_t count = 0;
+  const char* end = out.data + out.length;
+  for (const char* p = out.data; p < end; ++p) {
+    p = memchr(p, '\e', end - p);
+    if (p == NULL) {
+      break;
+    }
+    ++count;
+  }
+  return count;
+}
+
+/* Write all of `out` to stdout, which is in non-blocking mode.
+ *
+ * If the terminal has not yet drained what we wrote before, e.g. because it is
+ * connected via a slow SSH connection, the write stops early and we wait until
+ * the terminal accepts more bytes. The drawing thread keeps replacing the
+ * frame in `middle` meanwhile, so once we are done, we directly continue with
+ * the most recent frame and all frames in between are dropped.
+ *
+ * A frame is written completely, even if it has become outdated, because the
+ * next frame is printed as the difference to this one. This includes frames
+ * which are still written when `output_stop` is called, e.g. on a resize.
+ * Only if the terminal does not accept the rest within `STOP_TIMEOUT_NS`,
+ * the frame is given up and `cut_off` is set, see `output_stop`.
+ */
+static void write_frame(void) {
+  size_t written = 0;
+  uint64_t deadline = 0;
+  while (written < out.length) {
+    ssize_t n = write(STDOUT_FILENO, out.data + written, out.length - written);
+    if (n >= 0) {
+      written += n;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      /* Check `running` at least every 100 ms, so a stuck terminal does not
+       * prevent `output_stop` from returning. */
+      if (!atomic_load(&running)) {
+        if (deadline == 0) {
+          deadline = clock_now() + STOP_TIMEOUT_NS;
+        } else if (clock_now() >= deadline) {
+          break;
+        }
+      }
+      struct pollfd p = {.fd = STDOUT_FILENO, .events = POLLOUT};
+      poll(&p, 1, 100);
+    } else if (errno != EINTR) {
+      break;
+    }
+  }
+  cut_off = written < out.length;
+}
+
+/* Take the most recent frame from `middle` and print it to the sink. */
+static void print_next_frame(void) {
+  unsigned next = atomic_exchange(&middle, spare) & SLOT_MASK;
+  size_t cells;
+  size_t bytes;
+  if (sink == TUI_SINK_VIDEO) {
+    bytes = record_frame(next, &cells);
+  } else {
+    cells = encode_frame(next);
+    bytes = out.length;
+  }
+
+  atomic_fetch_add(&printed_frames, 1);
+  atomic_fetch_add(&printed_bytes, bytes);
+  atomic_fetch_add(&printed_escapes, count_escapes());
+  atomic_fetch_add(&printed_cells, cells);
+
+  switch (sink) {
+    case TUI_SINK_TERMINAL:
+      write_frame();
+      break;
+    case TUI_SINK_MEMORY:
+      buffer_append(&memory, out.data, out.length);
+      break;
+    case TUI_SINK_NULL:
+    case TUI_SINK_VIDEO:
+      break;
+  }
+  buffer_clear(&out);
+
+  spare = front;
+  front = next;
+}
+
+static void* output_thread(void* arg) {
+  (void)arg;
+  while (true) {
+    sem_wait(&frame_ready);
+    if (!atomic_load(&running)) {
+      break;
+    }
+    if ((atomic_load(&middle) & FRESH) == 0) {
+      /* We already took this frame after an earlier wake-up. */
+      continue;
+    }
+    print_next_frame();
+  }
+  return NULL;
+}
+
+void output_start(size_t width, size_t height, TuiSink output_sink,
+                  unsigned sink_caps, Video* sink_video) {
+  for (unsigned i = 0; i < SLOT_COUNT; ++i) {
+    slots[i] = (Frame){.cells = matrix_new(width, height, &null_cell),
+                       .changed = damage_new(width, height),
+                       .seq = 0};
+    stale[i] = damage_new(width, height);
+    damage_add_all(stale[i]);
+  }
+  back = 0;
+  atomic_store(&middle, 1);
+  front = 2;
+  spare = 3;
+  next_seq = 1;
+  buffer_init(&out);
+  encoder_init(&encoder, &out, sink_caps);
+  sink = output_sink;
+  caps = sink_caps;
+  video = sink_video;
+
+  if (sink == TUI_SINK_TERMINAL) {
+    /* Everything printed with stdio so far has to arrive before our
+     * frames. */
+    fflush(stdout);
+    stdout_flags = fcntl(STDOUT_FILENO, F_GETFL);
+    fcntl(STDOUT_FILENO, F_SETFL, stdout_flags | O_NONBLOCK);
+
+    sem_init(&frame_ready, 0, 0);
+    cut_off = false;
+    atomic_store(&running, true);
+    pthread_create(&thread, NULL, output_thread, NULL);
+  }
+}
+
+void output_stop(void) {
+  if (sink == TUI_SINK_TERMINAL) {
+    atomic_store(&running, false);
+    sem_post(&frame_ready);
+    pthread_join(thread, NULL);
+    sem_destroy(&frame_ready);
+    fcntl(STDOUT_FILENO, F_SETFL, stdout_flags);
+    if (cut_off) {
+      /* Whatever is printed next, e.g. the full redraw after a resize, must
+       * not end up inside the escape sequence or the synchronized update
+       * which the frame left open. */
+      const char* end = (caps & TERM_CAP_SYNC) ? CANCEL SYNC_END : CANCEL;
+      ssize_t n = write(STDOUT_FILENO, end, strlen(end));
+      (void)n;
+    }
+  }
+  encoder_free(&encoder);
+  buffer_free(&out);
+
+  for (unsigned i = 0; i < SLOT_COUNT; ++i) {
+    matrix_free(slots[i].cells);
+    damage_free(slots[i].changed);
+    damage_free(stale[i]);
+  }
+}
+
+Frame* output_begin_frame(Damage* damage, Damage** outdated) {
+  for (unsigned i = 0; i < SLOT_COUNT; ++i) {
+    damage_add_from(stale[i], damage);
+  }
+  Frame* f = &slots[back];
+  damage_reset(f->changed);
+  damage_add_from(f->changed, damage);
+  f->seq = next_seq++;
+  *outdated = stale[back];
+  return f;
+}
+
+void output_end_frame(void) {
+  damage_reset(stale[back]);
+  unsigned prev = atomic_exchange(&middle, back | FRESH);
+  if (prev & FRESH) {
+    atomic_fetch_add(&dropped_frames, 1);
+  }
+  back = prev & SLOT_MASK;
+  if (sink == TUI_SINK_TERMINAL) {
+    sem_post(&frame_ready);
+  } else {
+    print_next_frame();
+  }
+}
+
+TuiStats output_stats(void) {
+  return (TuiStats){.frames = atomic_load(&printed_frames),
+                    .dropped_frames = atomic_load(&dropped_frames),
+                    .bytes = atomic_load(&printed_bytes),
+                    .escapes = atomic_load(&printed_escapes),
+                    .cells = atomic_load(&printed_cells)};
+}
+
+Buffer* output_memory(void) {
+  return &memory;
+}
+
+void output_reset(void) {
+  atomic_store(&printed_frames, 0);
+  atomic_store(&dropped_frames, 0);
+  atomic_store(&printed_bytes, 0);
+  atomic_store(&printed_escapes, 0);
+  atomic_store(&printed_cells, 0);
+  buffer_free(&memory);
+}
@@ -0,0 +1,93 @@
+#ifndef TUI_OUTPUT_H
+#define TUI_OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "./tui_buffer.h"
+#include "./tui_layer.h"
+#include "./tui_matrix.h"
+#include "./tui_video.h"
+
+/* Where the frames are printed to. */
+typedef enum TuiSink {
+  TUI_SINK_TERMINAL, /* stdout, which has to be a terminal. */
+  TUI_SINK_MEMORY,   /* A buffer in memory, see `output_memory`. */
+  TUI_SINK_NULL,     /* Nowhere, frames are only encoded and counted. */
+  TUI_SINK_VIDEO,    /* A video file, see `tui_video.h`. Frames are rasterized
+                        instead of encoded as ANSI codes. */
+} TuiSink;
+
+/* Statistics about everything printed since the frames were started. */
+typedef struct TuiStats {
+  uint64_t frames;         /* How many frames were printed. */
+  uint64_t dropped_frames; /* How many frames were dropped, because the
+                              terminal was too slow to keep up. */
+  uint64_t bytes;          /* How many bytes were printed. */
+  uint64_t escapes;        /* How many ANSI escape sequences were printed. */
+  uint64_t cells;          /* How many cells were printed. */
+} TuiStats;
+
+/* A composed terminal frame, which is handed from the thread drawing the
+ * frames to the output thread printing them.
+ */
+typedef struct Frame {
+  Matrix* cells;   /* How the terminal should look like. */
+  Damage* changed; /* The cells which may differ from the previous frame. */
+  uint64_t seq;    /* Frames are numbered 1, 2, 3, ... in the order in which
+                      they were drawn. */
+} Frame;
+
+/* Allocate the frame buffers for a terminal of size `width` x `height` and
+ * start printing frames to `sink`, which understands the `TermCaps` in `caps`.
+ * Frames for `TUI_SINK_VIDEO` are appended to `video`, which is NULL for all
+ * other sinks.
+ *
+ * Frames for the terminal are printed by an output thread. Frames for the
+ * other sinks are printed directly by `output_end_frame`, so the statistics
+ * and the memory buffer are up to date as soon as it returns.
+ *
+ * Frames are passed to the output thread through a lock-free triple buffer:
+ * the drawing thread always has a buffer to draw into, the output thread
+ * always prints the most recent complete frame, and frames which are replaced
+ * before the output thread got to them are dropped. So a slow terminal never
+ * blocks the drawing thread.
+ */
+void output_start(size_t width, size_t height, TuiSink sink, unsigned caps,
+                  Video* video);
+
+/* Stop the output thread and deallocate the frame buffers. */
+void output_stop(void);
+
+/* Returns the frame which has to be drawn next.
+ *
+ * `damage` are the cells which have changed since the previous frame. The
+ * returned frame may be older than the previous frame, so `*outdated` is set
+ * to the cells of the returned frame which have to be drawn again. All other
+ * cells already have the correct content.
+ */
+Frame* output_begin_frame(Damage* damage, Damage** outdated);
+
+/* Hand the frame returned by `output_begin_frame` to the output thread. */
+void output_end_frame(void);
+
+/* Returns the statistics since the last call of `output_reset`. They are
+ * kept when the frame buffers are restarted after a resize.
+ *
+ * Frames are dropped if the output thread was still busy printing an older
+ * frame, e.g. because the terminal has not drained it.
+ */
+TuiStats output_stats(void);
+
+/* Returns the buffer with everything printed to `TUI_SINK_MEMORY`. The caller
+ * may clear it, e.g. to look at a single frame.
+ */
+Buffer* output_memory(void);
+
+/* Set all statistics to 0 and free the buffer of `TUI_SINK_MEMORY`. Must not
+ * be called while frames are printed, i.e. between `output_start` and
+ * `output_stop`.
+ */
+void output_reset(void);
+
+#endif /* TUI_OUTPUT_H */
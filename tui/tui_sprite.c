@@ -0,0 +1,53 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "./tui_sprite.h"
+
+Sprite* sprite_new(const char* rows[], size_t height, int origin_x,
+                   int origin_y, const char* keys, const Cell* cells) {
+  /* There are at most as many opaque cells and runs as characters. */
+  size_t size = 0;
+  for (size_t y = 0; y < height; ++y) {
+    size += strlen(rows[y]);
+  }
+
+  Sprite* s = malloc(sizeof(Sprite));
+  if (s == NULL) {
+    return NULL;
+  }
+  *s = (Sprite){.runs = malloc(size * sizeof(SpriteRun) + 1),
+                .run_count = 0,
+                .cells = malloc(size * sizeof(Cell) + 1)};
+  if (s->runs == NULL || s->cells == NULL) {
+    sprite_free(s);
+    return NULL;
+  }
+
+  size_t cell_count = 0;
+  for (size_t y = 0; y < height; ++y) {
+    SpriteRun* run = NULL;
+    for (size_t x = 0; rows[y][x] != 0; ++x) {
+      const char* key = strchr(keys, rows[y][x]);
+      if (key == NULL) {
+        run = NULL;
+        continue;
+      }
+      if (run == NULL) {
+        run = &s->runs[s->run_count++];
+        *run = (SpriteRun){.x = (int)x - origin_x,
+                           .y = (int)y - origin_y,
+                           .length = 0,
+                           .cells = s->cells + cell_count};
+      }
+      s->cells[cell_count++] = cells[key - keys];
+      ++run->length;
+    }
+  }
+  return s;
+}
+
+void sprite_free(Sprite* s) {
+  free(s->runs);
+  free(s->cells);
+  free(s);
+}
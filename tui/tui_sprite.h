@@ -0,0 +1,41 @@
+#ifndef TUI_SPRITE_H
+#define TUI_SPRITE_H
+
+#include <stddef.h>
+
+#include "./tui_matrix.h"
+
+/* A horizontal run of opaque cells in a sprite. */
+typedef struct SpriteRun {
+  int x;             /* The column of the first cell relative to the origin. */
+  int y;             /* The row relative to the origin. */
+  size_t length;     /* How many cells are in the run. */
+  const Cell* cells; /* The cells of the run. */
+} SpriteRun;
+
+/* A block of cells which is drawn as a whole, e.g. the ship.
+ *
+ * Sprites are built once and drawn many times. Transparent cells are not
+ * stored at all: the opaque cells are stored as runs, so drawing a sprite
+ * copies whole runs instead of checking each cell.
+ */
+typedef struct Sprite {
+  SpriteRun* runs;
+  size_t run_count;
+  Cell* cells; /* The cells of all runs. */
+} Sprite;
+
+/* Build a sprite from `height` strings, one for each row.
+ *
+ * Each character is looked up in `keys` and replaced with the cell at the
+ * same index in `cells`. Characters which are not in `keys`, e.g. '.', are
+ * transparent. The character at (`origin_x`, `origin_y`) is the position at
+ * which the sprite is drawn.
+ */
+Sprite* sprite_new(const char* rows[], size_t height, int origin_x,
+                   int origin_y, const char* keys, const Cell* cells);
+
+/* Deallocate a sprite. */
+void sprite_free(Sprite* s);
+
+#endif /* TUI_SPRITE_H */
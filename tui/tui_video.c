@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./tui_video.h"
+
+/* How the frames are stored in the file. */
+typedef enum VideoFormat {
+  VIDEO_Y4M, /* YUV4MPEG2, the pixels are stored as planes Y, U and V. */
+  VIDEO_PPM, /* Binary PPM, the pixels are stored as interleaved R, G, B. */
+} VideoFormat;
+
+/* How many colors a terminal with 16 colors has. */
+#define PALETTE_SIZE 16
+
+/* How many different color codes are remembered with their palette index. */
+#define CODE_CACHE_SIZE 64
+
+/* The 16 colors of xterm as RGB. */
+static const unsigned char palette_rgb[PALETTE_SIZE][3] = {
+    {0, 0, 0},       {205, 0, 0},     {0, 205, 0},     {205, 205, 0},
+    {0, 0, 238},     {205, 0, 205},   {0, 205, 205},   {229, 229, 229},
+    {127, 127, 127}, {255, 0, 0},     {0, 255, 0},     {255, 255, 0},
+    {92, 92, 255},   {255, 0, 255},   {0, 255, 255},   {255, 255, 255},
+};
+
+struct Video {
+  FILE* file;
+  VideoFormat format;
+  size_t width;  /* In pixels. */
+  size_t height; /* In pixels. */
+  unsigned char* pixels; /* The current frame in the layout of `format`. */
+  size_t size;           /* How many bytes `pixels` has. */
+  unsigned char palette[PALETTE_SIZE][3]; /* In the color space of `format`. */
+  struct {
+    const char* code;
+    unsigned char text;       /* Palette index if used as text color. */
+    unsigned char background; /* Palette index if used as background color. */
+  } codes[CODE_CACHE_SIZE];
+  size_t code_count;
+};
+
+/* Convert the RGB color `rgb` to Y'CbCr as in BT.601 with limited range,
+ * which is what players expect from YUV4MPEG2.
+ */
+static void rgb_to_ycbcr(const unsigned char* rgb, unsigned char* ycbcr) {
+  double r = rgb[0];
+  double g = rgb[1];
+  double b = rgb[2];
+  ycbcr[0] = 16 + (65.481 * r + 128.553 * g + 24.966 * b) / 255 + 0.5;
+  ycbcr[1] = 128 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255 + 0.5;
+  ycbcr[2] = 128 + (112.0 * r - 93.786 * g - 18.214 * b) / 255 + 0.5;
+}
+
+/* Returns the palette index of the SGR code `code`, e.g. 1 for "\e[0;31m".
+ * Text colors 30-37 and 90-97 are used if `text` is true, background colors
+ * 40-47 and 100-107 otherwise. Returns `def` if the code has no such color.
+ */
+static unsigned char parse_color(const char* code, bool text,
+                                 unsigned char def) {
+  unsigned char color = def;
+  const char* p = code;
+  while (*p != 0) {
+    if (*p < '0' || *p > '9') {
+      ++p;
+      continue;
+    }
+    int n = strtol(p, (char**)&p, 10);
+    int base = text ? 30 : 40;
+    if (n >= base && n < base + 8) {
+      color = n - base;
+    } else if (n >= base + 60 && n < base + 68) {
+      color = 8 + n - base - 60;
+    }
+  }
+  return color;
+}
+
+/* Returns the palette index of `code` as text color if `text` is true, or as
+ * background color otherwise.
+ *
+ * Cells point to a handful of constant color codes, so the parsed colors are
+ * remembered by address and every code is only parsed once.
+ */
+static unsigned char code_color(Video* v, const char* code, bool text) {
+  for (size_t i = 0; i < v->code_count; ++i) {
+    if (v->codes[i].code == code) {
+      return text ? v->codes[i].text : v->codes[i].background;
+    }
+  }
+  unsigned char text_color = parse_color(code, true, 7);
+  unsigned char background_color = parse_color(code, false, 0);
+  if (v->code_count < CODE_CACHE_SIZE) {
+    v->codes[v->code_count].code = code;
+    v->codes[v->code_count].text = text_color;
+    v->codes[v->code_count].background = background_color;
+    ++v->code_count;
+  }
+  return text ? text_color : background_color;
+}
+
+Video* video_open(const char* path, size_t width, size_t height,
+                  unsigned fps) {
+  Video* v = malloc(sizeof(Video));
+  if (v == NULL) {
+    return NULL;
+  }
+  size_t path_length = strlen(path);
+  bool ppm = path_length >= 4 && strcmp(path + path_length - 4, ".ppm") == 0;
+  *v = (Video){.file = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb"),
+               .format = ppm ? VIDEO_PPM : VIDEO_Y4M,
+               .width = width * VIDEO_CELL_WIDTH,
+               .height = height * VIDEO_CELL_HEIGHT,
+               .code_count = 0};
+  v->size = v->width * v->height * 3;
+  v->pixels = calloc(v->size, 1);
+  if (v->file == NULL || v->pixels == NULL) {
+    if (v->file != NULL && v->file != stdout) {
+      fclose(v->file);
+    }
+    free(v->pixels);
+    free(v);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < PALETTE_SIZE; ++i) {
+    if (v->format == VIDEO_Y4M) {
+      rgb_to_ycbcr(palette_rgb[i], v->palette[i]);
+    } else {
+      memcpy(v->palette[i], palette_rgb[i], 3);
+    }
+  }
+  if (v->format == VIDEO_Y4M) {
+    fprintf(v->file, "YUV4MPEG2 W%zu H%zu F%u:1 Ip A1:1 C444\n", v->width,
+            v->height, fps);
+  }
+  return v;
+}
+
+void video_close(Video* v) {
+  if (v->file == stdout) {
+    fflush(v->file);
+  } else {
+    fclose(v->file);
+  }
+  free(v->pixels);
+  free(v);
+}
+
+/* Fill the rectangle of `w` x `h` pixels at (x, y) with palette color `c`. */
+static void fill(Video* v, size_t x, size_t y, size_t w, size_t h,
+                 unsigned char c) {
+  const unsigned char* color = v->palette[c];
+  for (size_t row = y; row < y + h; ++row) {
+    if (v->format == VIDEO_Y4M) {
+      size_t plane = v->width * v->height;
+      for (size_t k = 0; k < 3; ++k) {
+        memset(v->pixels + k * plane + row * v->width + x, color[k], w);
+      }
+    } else {
+      unsigned char* p = v->pixels + (row * v->width + x) * 3;
+      for (size_t i = 0; i < w; ++i, p += 3) {
+        memcpy(p, color, 3);
+      }
+    }
+  }
+}
+
+/* Rasterize the cell of `m` at (x, y). */
+static void draw_cell(Video* v, Matrix* m, size_t x, size_t y) {
+  const Cell* c = matrix_cell_at(m, x, y);
+  unsigned char text = code_color(v, c->text_color, true);
+  unsigned char background = code_color(v, c->background_color, false);
+  size_t px = x * VIDEO_CELL_WIDTH;
+  size_t py = y * VIDEO_CELL_HEIGHT;
+  fill(v, px, py, VIDEO_CELL_WIDTH, VIDEO_CELL_HEIGHT, background);
+  if (c->content != ' ' && c->content != 0) {
+    fill(v, px + VIDEO_CELL_WIDTH / 4, py + VIDEO_CELL_HEIGHT / 4,
+         VIDEO_CELL_WIDTH / 2, VIDEO_CELL_HEIGHT / 2, text);
+  }
+}
+
+size_t video_write_frame(Video* v, Matrix* m, Size2* positions, size_t count) {
+  if (positions == NULL) {
+    for (size_t y = 0; y < matrix_height(m); ++y)
+      for (size_t x = 0; x < matrix_width(m); ++x)
+        draw_cell(v, m, x, y);
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      draw_cell(v, m, positions[i].x, positions[i].y);
+    }
+  }
+
+  int header;
+  if (v->format == VIDEO_Y4M) {
+    header = fprintf(v->file, "FRAME\n");
+  } else {
+    header = fprintf(v->file, "P6\n%zu %zu\n255\n", v->width, v->height);
+  }
+  fwrite(v->pixels, 1, v->size, v->file);
+  return header + v->size;
+}
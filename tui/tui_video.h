@@ -0,0 +1,47 @@
+#ifndef TUI_VIDEO_H
+#define TUI_VIDEO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./tui_io.h"
+#include "./tui_matrix.h"
+
+/* How many pixels wide and high a cell is in the video. */
+#define VIDEO_CELL_WIDTH 8
+#define VIDEO_CELL_HEIGHT 16
+
+/* A recording of frames as raw video, which can be watched or converted with
+ * common tools, e.g. `ffmpeg -i game.y4m game.mp4`.
+ *
+ * Each cell is rasterized to a block of pixels in its background color. Cells
+ * which show a character other than the space get a smaller block in their
+ * text color in the middle. The colors are the 16 colors of xterm.
+ */
+typedef struct Video Video;
+
+/* Open a video for frames of `width` x `height` cells, which is written to the
+ * file at `path`, or to stdout if `path` is "-", e.g. to pipe it into another
+ * program.
+ *
+ * If `path` ends with ".ppm", the frames are written as binary PPM images one
+ * after the other. Otherwise the video is a YUV4MPEG2 stream with 4:4:4
+ * chroma, which is played with `fps` frames per second.
+ *
+ * Returns NULL if the file could not be opened.
+ */
+Video* video_open(const char* path, size_t width, size_t height, unsigned fps);
+
+/* Write the remaining frames and close the video. */
+void video_close(Video* v);
+
+/* Append the frame `m` to the video.
+ *
+ * The previous frame is kept, so if `positions` is not NULL, only the `count`
+ * cells at `positions` are rasterized again. Otherwise all cells are.
+ *
+ * Returns how many bytes were written.
+ */
+size_t video_write_frame(Video* v, Matrix* m, Size2* positions, size_t count);
+
+#endif /* TUI_VIDEO_H */